@@ -0,0 +1,21 @@
+# - Try to find the single precision FFTW3 library, used for the batched FFT analysis of the DRS4 waveforms
+# Once done this will define
+#  FFTW_FOUND - System has fftw3f
+#  FFTW_INCLUDE_DIRS - The fftw3 include directories
+#  FFTW_LIBRARIES - The libraries needed to use fftw3f
+
+find_path(FFTW_INCLUDE_DIR fftw3.h
+  HINTS "${FFTWPATH}/include" "$ENV{FFTWPATH}/include")
+
+find_library(FFTW_LIBRARY NAMES fftw3f
+  HINTS "${FFTWPATH}/lib" "$ENV{FFTWPATH}/lib")
+
+set(FFTW_LIBRARIES ${FFTW_LIBRARY})
+set(FFTW_INCLUDE_DIRS ${FFTW_INCLUDE_DIR})
+
+IF(FFTW_LIBRARY AND FFTW_INCLUDE_DIR)
+   SET(FFTW_FOUND TRUE)
+   MESSAGE(STATUS "Found FFTW3 (single precision) library and headers.")
+ENDIF(FFTW_LIBRARY AND FFTW_INCLUDE_DIR)
+
+mark_as_advanced(FFTW_LIBRARY FFTW_INCLUDE_DIR)
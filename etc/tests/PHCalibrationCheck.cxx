@@ -0,0 +1,106 @@
+// Regression check of the closed-form pulse height calibration (PHCalibration) against the
+// TF1::GetX inversion of the erf fit which CMSPixelHelper used before.
+// Returns non-zero if the charges differ by more than MAX_DIFF electrons.
+
+#include "eudaq/PHCalibration.hh"
+
+#include <TF1.h>
+#include <TMath.h>
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+  const double MAX_DIFF = 0.01; // electrons, the series of ErfInverse is good to ~0.004 e
+  const unsigned N_FITS = 2000;
+  const unsigned N_ADC = 256;
+
+  /** Deterministic pseudo-random numbers, the check must not depend on the platform's rand() */
+  struct LCG {
+    uint64_t state;
+    explicit LCG(uint64_t seed) : state(seed) {}
+    double Uniform(double lo, double hi) {
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+      return lo + (hi - lo) * double(state >> 11) / double(1ULL << 53);
+    }
+  };
+
+}
+
+int main() {
+  TF1 fit("phcalibration_check", "[3]*(TMath::Erf((x-[0])/[1])+[2])", -4096, 4096);
+  LCG rng(42);
+  eudaq::PHCalibration cal;
+  std::vector<eudaq::VCALDict> fits;
+  unsigned n_compared = 0, n_failed = 0;
+  double max_diff = 0;
+  for (unsigned i = 0; i < N_FITS; i++) {
+    // the range of the fit parameters in the calibration files of the CMS pixel telescope planes
+    eudaq::VCALDict d;
+    d.row = int(i % eudaq::PHCalibration::NROWS);
+    d.col = int(i / eudaq::PHCalibration::NROWS % eudaq::PHCalibration::NCOLS);
+    d.par0 = float(rng.Uniform(50, 400));
+    d.par1 = float(rng.Uniform(100, 600));
+    d.par2 = float(rng.Uniform(0.5, 1.5));
+    d.par3 = float(rng.Uniform(50, 200));
+    d.calibration_factor = float(rng.Uniform(45, 70));
+    size_t roc = i / (eudaq::PHCalibration::NROWS * eudaq::PHCalibration::NCOLS);
+    cal.Set(roc, d.col, d.row, d);
+    fits.push_back(d);
+    fit.SetParameters(d.par0, d.par1, d.par2, d.par3);
+    for (unsigned adc = 0; adc < N_ADC; adc++) {
+      for (double frac = 0; frac < 1; frac += 0.25) {
+        double val = adc + frac;
+        double y = val / d.par3 - d.par2;
+        float charge = eudaq::PHCalibration::Invert(d, val);
+        if (!(std::fabs(y) < 0.999)) {
+          // GetX has no (well defined) root there, the inversion must give 0 outside of the erf range
+          if (!(std::fabs(y) < 1) && charge != 0) {
+            std::cout << "par " << d.par0 << " " << d.par1 << " " << d.par2 << " " << d.par3
+                      << " adc " << val << ": " << charge << " outside of the fit range" << std::endl;
+            ++n_failed;
+          }
+          continue;
+        }
+        double x = fit.GetX(val);
+        if (std::fabs(x) >= 4096) continue;
+        float expected = d.calibration_factor * float(x);
+        double diff = std::fabs(charge - expected);
+        ++n_compared;
+        if (diff > max_diff) max_diff = diff;
+        // large charges are only good to a few float ulps
+        if (diff > std::max(MAX_DIFF, 4. * std::numeric_limits<float>::epsilon() * std::fabs(expected))) {
+          std::cout << "par " << d.par0 << " " << d.par1 << " " << d.par2 << " " << d.par3
+                    << " adc " << val << ": " << charge << " != " << expected << std::endl;
+          ++n_failed;
+        }
+      }
+    }
+  }
+  // the lookup table must give exactly the closed form for integer pulse heights
+  cal.BuildLUT(N_ADC);
+  for (unsigned i = 0; i < N_FITS; i++) {
+    const eudaq::VCALDict & d = fits[i];
+    size_t roc = i / (eudaq::PHCalibration::NROWS * eudaq::PHCalibration::NCOLS);
+    for (unsigned adc = 0; adc < N_ADC; adc++) {
+      float lut = cal.Charge(roc, d.col, d.row, adc), exact = eudaq::PHCalibration::Invert(d, adc);
+      if (lut != exact) {
+        std::cout << "lookup table of pixel " << d.col << "/" << d.row << " adc " << adc << ": " << lut << " != " << exact << std::endl;
+        ++n_failed;
+      }
+    }
+  }
+  // N_FITS doesn't reach the last pixel of the ROC
+  if (!std::isnan(cal.Charge(0, eudaq::PHCalibration::NCOLS - 1, eudaq::PHCalibration::NROWS - 1, 100))) {
+    std::cout << "uncalibrated pixel did not give NaN" << std::endl;
+    ++n_failed;
+  }
+  std::cout << "PHCalibrationCheck: compared " << n_compared << " charges, largest difference "
+            << max_diff << " e, " << n_failed << " failures" << std::endl;
+  return n_failed ? 1 : 0;
+}
@@ -17,6 +17,8 @@ int main(int /*unused*/, char ** argv) {
   eudaq::Option<std::string> ipat(op, "i", "inpattern", "../data/run$6R.raw", "string", "Input filename pattern");
   eudaq::Option<std::string> opat(op, "o", "outpattern", "test$6R$X", "string", "Output filename pattern");
   eudaq::OptionFlag async(op, "a", "nosync", "Disables Synchronisation with TLU events");
+  eudaq::OptionFlag mapped(op, "m", "mmap", "Memory-map the input files (they must be complete)");
+  eudaq::OptionFlag singlepass(op, "s", "singlepass", "Read the input only once, keeping the events used for the decoding calibration in memory");
   eudaq::Option<size_t> syncEvents(op, "n" ,"syncevents",1000,"size_t","Number of events that need to be synchronous before they are used");
   eudaq::Option<uint64_t> syncDelay(op, "d" ,"longDelay",20,"uint64_t","us time long time delay");
   eudaq::Option<std::string> level(op, "l", "log-level", "INFO", "level", "The minimum level for displaying log messages locally");
@@ -30,33 +32,51 @@ int main(int /*unused*/, char ** argv) {
     std::sort(numbers2.begin(), numbers2.end());
     eudaq::multiFileReader reader2(!async.Value());
     for (size_t i = 0; i < op.NumArgs(); ++i) {
-      reader2.addFileReader(op.GetArg(i), ipat.Value());
+      reader2.addFileReader(op.GetArg(i), ipat.Value(), mapped.Value());
     }
+    bool has_tu = reader2.hasTUEvent();
+    // events read in step 1, converted again in step 2 instead of reading the files a second time
+    std::vector<std::shared_ptr<eudaq::DetectorEvent> > replay;
+    bool keep_events = singlepass.Value();
     /** -----------------------------------------------
      * First step: Find analogue decoding in 100k events:
      * -----------------------------------------------*/
     print_banner("STEP 1: Calculating decoding offsets ...", '~');
     Configuration config(configFileName.Value(), "Converter.telescopetree", true);
     if (config.Get("decoding_offset_v", "").empty()) {  // only run the decoder if the config file does not already have entries
+      // the decoder converts with its own copies of the plugins, so that their decoding state, statistics and
+      // histograms don't carry over into the conversion of step 2
+      // (the guard restores the global plugins before the clones are deleted, also if the decoding throws)
+      std::unique_ptr<eudaq::PluginManager> decoder_plugins(eudaq::PluginManager::GetInstance().Clone());
+      eudaq::PluginManager::ThreadInstanceGuard decoder_instance(decoder_plugins.get());
       std::shared_ptr<eudaq::FileWriter> decoder(FileWriterFactory::Create("cmsdecoder", &config));
       decoder->StartRun(reader2.RunNumber());
+      if (keep_events && decoder->GetMaxEventNumber() <= 0) {
+        // without a limit step 1 reads the whole run, which would all be held in memory
+        EUDAQ_WARN("--singlepass needs an event limit for the decoding, reading the input twice");
+        keep_events = false;
+      }
       ProgressBar pbar(uint32_t(decoder->GetMaxEventNumber()));
       uint32_t event_nr = 0;
+      bool more = true;
 
       do {
         if (!numbers2.empty() && reader2.GetDetectorEvent().GetEventNumber() > numbers2.back()) {
           break;
         }
+        if (keep_events) { replay.push_back(reader2.GetDetectorEvent_ptr()); }
         if (reader2.GetDetectorEvent().IsBORE() || reader2.GetDetectorEvent().IsEORE() || numbers2.empty() ||
-            std::find(numbers2.begin(), numbers2.end(), reader2.GetDetectorEvent().GetEventNumber()) != numbers2.end()) {
+            std::binary_search(numbers2.begin(), numbers2.end(), reader2.GetDetectorEvent().GetEventNumber())) {
           decoder->WriteEvent(reader2.GetDetectorEvent());
           if (dbg > 0) { std::cout << "writing one more event" << std::endl; }
           ++event_nr;
           if (event_nr == decoder->GetMaxEventNumber() + 1) { decoder->GetStats(reader2.GetDetectorEvent()); }
           pbar.update(event_nr);
         }
-      } while (reader2.NextEvent() && (decoder->GetMaxEventNumber() <= 0 || event_nr <=
+      } while ((more = reader2.NextEvent(numbers2)) && (decoder->GetMaxEventNumber() <= 0 || event_nr <=
                                                                             decoder->GetMaxEventNumber()));// Added " && (writer->GetMaxEventNumber() <= 0 || event_nr <= writer->GetMaxEventNumber())" to prevent looping over all events when desired: DA
+      // the event that ended the loop has been read but not yet buffered
+      if (keep_events && more) { replay.push_back(reader2.GetDetectorEvent_ptr()); }
 
       decoder->Run(); // Calculate Level1, decoding offsets and timing compensations (alphas)
 
@@ -84,36 +104,52 @@ int main(int /*unused*/, char ** argv) {
      * -----------------------------------------------*/
       std::vector<unsigned> numbers = parsenumbers(events.Value());
       std::sort(numbers.begin(), numbers.end());
-      eudaq::multiFileReader reader(!async.Value());
-      for (size_t i = 0; i < op.NumArgs(); ++i) {
-          reader.addFileReader(op.GetArg(i), ipat.Value());
+      // in single-pass mode the reader of step 1 continues after the replayed events
+      eudaq::multiFileReader * reader = &reader2;
+      std::unique_ptr<eudaq::multiFileReader> reopened;
+      if (!keep_events) {
+        reopened.reset(new eudaq::multiFileReader(!async.Value()));
+        for (size_t i = 0; i < op.NumArgs(); ++i) {
+          reopened->addFileReader(op.GetArg(i), ipat.Value(), mapped.Value());
+        }
+        reader = reopened.get();
       }
+      size_t i_replay = 0;
+      auto current_event = [&]() -> const eudaq::DetectorEvent & {
+        return i_replay < replay.size() ? *replay[i_replay] : reader->GetDetectorEvent();
+      };
+      auto next_event = [&]() {
+        // the last buffered event is the current event of the reader
+        if (i_replay < replay.size() && ++i_replay < replay.size()) { return true; }
+        return reader->NextEvent(numbers);
+      };
 
       print_banner("STARTING EUDAQ " + to_string(type.Value()) + " CONVERTER");
 
       std::shared_ptr<eudaq::FileWriter> writer(FileWriterFactory::Create(type.Value(), &config));
-      writer->setTU(reader.hasTUEvent());
+      writer->setTU(has_tu);
 //      writer->SetConfig(&config);
       writer->SetFilePattern(opat.Value());
-      writer->StartRun(reader.RunNumber());
+      writer->StartRun(reader->RunNumber());
       auto pbar = ProgressBar(uint32_t(writer->GetMaxEventNumber()));
       auto event_nr = 0;
       do {
-        if ( !numbers.empty() && reader.GetDetectorEvent().GetEventNumber()>numbers.back() )
+        const eudaq::DetectorEvent & dev = current_event();
+        if ( !numbers.empty() && dev.GetEventNumber()>numbers.back() )
         { break; }
-        if (reader.GetDetectorEvent().IsBORE() || reader.GetDetectorEvent().IsEORE() || numbers.empty() ||
-        std::find(numbers.begin(), numbers.end(), reader.GetDetectorEvent().GetEventNumber()) != numbers.end()) {
-          writer->WriteEvent(reader.GetDetectorEvent());
+        if (dev.IsBORE() || dev.IsEORE() || numbers.empty() ||
+        std::binary_search(numbers.begin(), numbers.end(), dev.GetEventNumber())) {
+          writer->WriteEvent(dev);
           ++event_nr;
           if (writer->GetMaxEventNumber() != 0){
             if (event_nr == writer->GetMaxEventNumber() + 1)
-            { writer->GetStats(reader.GetDetectorEvent()); }
+            { writer->GetStats(dev); }
             pbar.update(event_nr);
           }
           else
           if (event_nr % 1000 == 0) { std::cout<<"\rProcessing event: "<< std::setfill('0') << std::setw(7) << event_nr << " " << std::flush; }
         }
-      } while (reader.NextEvent() && (writer->GetMaxEventNumber() <= 0 || event_nr <= writer->GetMaxEventNumber()));// Added " && (writer->GetMaxEventNumber() <= 0 || event_nr <= writer->GetMaxEventNumber())" to prevent looping over all events when desired: DA
+      } while (next_event() && (writer->GetMaxEventNumber() <= 0 || event_nr <= writer->GetMaxEventNumber()));// Added " && (writer->GetMaxEventNumber() <= 0 || event_nr <= writer->GetMaxEventNumber())" to prevent looping over all events when desired: DA
     if(dbg>0) { std::cout<< "no more events to read" << std::endl; }
     
   } catch (...) {
@@ -4,6 +4,7 @@
 #include <deque>
 #include <algorithm>
 #include <iostream>
+#include <memory>
 #include "eudaq/Serializer.hh"
 #include "eudaq/Exception.hh"
 
@@ -28,6 +29,22 @@ namespace eudaq {
       size_t m_offset;
   };
 
+  /** Reads from memory owned by someone else (e.g. a received packet) without copying it first.
+   *  View() hands out references into it that keep owner alive, so RawDataEvent blocks don't copy their data.
+   */
+  class SharedBufferDeserializer : public Deserializer {
+    public:
+      SharedBufferDeserializer(const unsigned char * data, size_t len, const std::shared_ptr<const void> & owner)
+        : m_data(data), m_len(len), m_offset(0), m_owner(owner) {}
+      virtual bool HasData() { return m_offset < m_len; }
+      virtual const unsigned char * View(size_t len, std::shared_ptr<const void> & source);
+    private:
+      virtual void Deserialize(unsigned char * data, size_t len);
+      const unsigned char * m_data;
+      size_t m_len, m_offset;
+      std::shared_ptr<const void> m_owner;
+  };
+
 }
 
 #endif // EUDAQ_INCLUDED_BufferSerializer
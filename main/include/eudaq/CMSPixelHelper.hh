@@ -2,8 +2,10 @@
 #include "constants.h"
 #include "datasource_evt.h"
 #include "Utils.hh"
+#include "PHCalibration.hh"
 #include <exception>
 #include <fstream>
+#include <memory>
 
 #if USE_LCIO
 #  include "IMPL/LCEventImpl.h"
@@ -40,24 +42,40 @@ using namespace pxar;
 
 namespace eudaq {
 
-struct VCALDict {
-  int row;
-  int col;
-  float par0;
-  float par1;
-  float par2;
-  float par3;
-  float calibration_factor;
-};
+  /** The pxar decoder chain of one converter. It lives for the whole run and is fed event by event,
+   *  so the decoder keeps its settings, black levels and statistics between events. */
+  struct CMSPixelPipe {
+    evtSource src;
+    passthroughSplitter splitter;
+    dtbEventDecoder decoder;
+    dataSink<pxar::Event*> pump;
+  };
+
+  /** Owner of a CMSPixelPipe. The stages point to each other, so a copy (cloned plugin) starts without one. */
+  class CMSPixelPipeHolder {
+  public:
+    CMSPixelPipeHolder() {}
+    CMSPixelPipeHolder(const CMSPixelPipeHolder &) {}
+    CMSPixelPipeHolder & operator=(const CMSPixelPipeHolder &) { pipe.reset(); return *this; }
+    std::unique_ptr<CMSPixelPipe> pipe;
+  };
 
   class CMSPixelHelper {
   public:
     std::map<std::string, float > roc_calibrations = {{"psi46v2", 65}, {"psi46digv21respin", 47}, {"proc600", 47}};
-    CMSPixelHelper(std::string event_type) : do_conversion(true), m_event_type(event_type){ m_conv_cfg = new Configuration(""); }
+    CMSPixelHelper(std::string event_type) : do_conversion(true), m_event_type(event_type){}
+    /** Copies the settings for another plugin manager (see DataConverterPlugin::Clone). The copy keeps its own
+     *  decoding state and statistics and books its own histograms when it is initialised. */
+    CMSPixelHelper(const CMSPixelHelper & other)
+      : roc_calibrations(other.roc_calibrations), ph_calibration(other.ph_calibration),
+        blackV(other.blackV), uBlackV(other.uBlackV), levelSV(other.levelSV), decodingOffsetVector2(other.decodingOffsetVector2),
+        DecodingFile(0), DecodingDirectory(0), m_roctype(other.m_roctype), m_tbmtype(other.m_tbmtype), m_planeid(other.m_planeid),
+        m_nplanes(other.m_nplanes), m_detector(other.m_detector), m_rotated_pcb(other.m_rotated_pcb), m_event_type(other.m_event_type),
+        do_conversion(other.do_conversion), do_decoding(other.do_decoding), m_conv_cfg(other.m_conv_cfg),
+        decodingOffsetVector(other.decodingOffsetVector), decodingAlphasVector(other.decodingAlphasVector), level1Vector(other.level1Vector) {}
     void set_conversion(bool val) { do_conversion = val; }
     bool get_conversion() { return do_conversion; }
-    std::map< std::string, VCALDict> vcal_vals;
-    TF1 * fFitfunction;
+    PHCalibration ph_calibration;
       std::vector<TH1F *> hEncode;
       std::vector<TH1F *> hUblack;
       std::vector<TH1F *> hBlack;
@@ -76,22 +94,17 @@ struct VCALDict {
       std::vector<TH2F *> h2black;
       std::vector<TH2F *> h2uBlack;
       std::vector<TH2F *> h2lastDac;
-      std::vector<float> *blackV;
-      std::vector<float> *uBlackV;
-      std::vector<int16_t> *levelSV;
-      std::vector<float> *decodingOffsetVector2;
+      /** header levels carried from one decoder chain to the next */
+      mutable std::vector<float> blackV;
+      mutable std::vector<float> uBlackV;
+      mutable std::vector<int16_t> levelSV;
+      mutable std::vector<float> decodingOffsetVector2;
 
       TFile *DecodingFile;
       TDirectory *DecodingDirectory;
 
-    void initializeFitfunction(){fFitfunction = new TF1("fitfunc", "[3]*(TMath::Erf((x-[0])/[1])+[2])",-4096,4096);}
-
-    float getCharge(VCALDict d, float val, float factor = 65.) const {
-      fFitfunction->SetParameters(d.par0, d.par1, d.par2, d.par3);
-      return d.calibration_factor * float(fFitfunction->GetX(val));
-    }
-
-    virtual void SetConfig(Configuration * conv_cfg) { m_conv_cfg = conv_cfg; }
+    /** Keeps a copy, the section is changed in Initialize */
+    virtual void SetConfig(Configuration * conv_cfg) { if (conv_cfg) m_conv_cfg = *conv_cfg; }
 
     void Initialize(const Event & bore, const Configuration & cnf) {
       DeviceDictionary* devDict;
@@ -111,14 +124,16 @@ struct VCALDict {
       if (m_roctype == 0x0)
         { EUDAQ_ERROR("Roctype" + to_string((int) m_roctype) + " not propagated correctly to CMSPixelConverterPlugin"); }
       read_PHCalibrationData(cnf);
-      initializeFitfunction();
+      RetirePipe();
 
       /** Decoding of the analogue telescope */
-      m_conv_cfg->SetSection("Converter.telescopetree");
-      do_decoding = m_conv_cfg->Get("decoding_offset_v", "").empty() and TString("DUT").CompareTo(TString(m_detector)) == 0;
-      decodingOffsetVector = m_conv_cfg->Get("decoding_offset_v", std::vector<float>(16, m_conv_cfg->Get("decoding_offset", 0.)));
-      level1Vector = m_conv_cfg->Get("decoding_l1_v", std::vector<float>(16, 0.));
-      decodingAlphasVector = m_conv_cfg->Get("decoding_alphas_v", std::vector<float>(16, 0.));
+      m_conv_cfg.SetSection("Converter.telescopetree");
+      /** charges of all pulse heights [0, ph_charge_lut) of every pixel are precomputed, 0 = invert the fit per hit */
+      ph_calibration.BuildLUT(m_conv_cfg.Get("ph_charge_lut", 0));
+      do_decoding = m_conv_cfg.Get("decoding_offset_v", "").empty() and TString("DUT").CompareTo(TString(m_detector)) == 0;
+      decodingOffsetVector = m_conv_cfg.Get("decoding_offset_v", std::vector<float>(16, m_conv_cfg.Get("decoding_offset", 0.)));
+      level1Vector = m_conv_cfg.Get("decoding_l1_v", std::vector<float>(16, 0.));
+      decodingAlphasVector = m_conv_cfg.Get("decoding_alphas_v", std::vector<float>(16, 0.));
       std::cout << "Using decoding offsets: " << to_string(decodingOffsetVector, ", ", 0, 3) << std::endl;
       std::cout << "Using decoding Level1: " << to_string(level1Vector, ", ", 0, 3) << std::endl;
       std::cout << "Using decoding alphas: " << to_string(decodingAlphasVector, ", ", 0, 3) << std::endl;
@@ -148,36 +163,54 @@ struct VCALDict {
 
       if(do_decoding) {
           for (size_t it = 0; it < m_nplanes; it++) {
-              hEncode.push_back(new TH1F(TString::Format("encoded_%d", int(it)), TString::Format("encoded_%d", int(it)), 1000, -500, 500));
-              hUblack.push_back(new TH1F(TString::Format("uBlack_%d", int(it)), TString::Format("uBlack_%d", int(it)), 1000, -500, 500));
-              hBlack.push_back(new TH1F(TString::Format("black_%d", int(it)), TString::Format("black_%d", int(it)), 1000, -500, 500));
-              hc0.push_back(new TH1F(TString::Format("c0_%d", int(it)), TString::Format("c0_%d", int(it)), 1000, -500, 500));
-              hc1.push_back(new TH1F(TString::Format("c1_%d", int(it)), TString::Format("c1_%d", int(it)), 1000, -500, 500));
-              hr0.push_back(new TH1F(TString::Format("r0_%d", int(it)), TString::Format("r0_%d", int(it)), 1000, -500, 500));
-              hr1.push_back(new TH1F(TString::Format("r1_%d", int(it)), TString::Format("r1_%d", int(it)), 1000, -500, 500));
-              hcr.push_back(new TH1F(TString::Format("cr_%d", int(it)), TString::Format("cr_%d", int(it)), 1000, -500, 500));
-              pblack.push_back(new TProfile(TString::Format("pblack_%d", int(it)), TString::Format("pblack_%d", int(it)), 10000, 0, 1000000, -500, 500));
-              pUblack.push_back(new TProfile(TString::Format("pUblack_%d", int(it)), TString::Format("pUblack_%d", int(it)), 10000, 0, 1000000, -500, 500));
-              h2c0.push_back(new TH2F(TString::Format("h2c0_%d", int(it)), TString::Format("h2c0_%d", int(it)), 10000, 0, 1000000, 1000, -500, 500));
-              h2c1.push_back(new TH2F(TString::Format("h2c1_%d", int(it)), TString::Format("h2c1_%d", int(it)), 10000, 0, 1000000, 1000, -500, 500));
-              h2r0.push_back(new TH2F(TString::Format("h2r0_%d", int(it)), TString::Format("h2r0_%d", int(it)), 10000, 0, 1000000, 1000, -500, 500));
-              h2r1.push_back(new TH2F(TString::Format("h2r1_%d", int(it)), TString::Format("h2r1_%d", int(it)), 10000, 0, 1000000, 1000, -500, 500));
-              h2cr.push_back(new TH2F(TString::Format("h2cr_%d", int(it)), TString::Format("h2cr_%d", int(it)), 10000, 0, 1000000, 1000, -500, 500));
-              h2black.push_back(new TH2F(TString::Format("h2black_%d", int(it)), TString::Format("h2black_%d", int(it)), 10000, 0, 1000000, 1000, -500, 500));
-              h2uBlack.push_back(new TH2F(TString::Format("h2uBlack_%d", int(it)), TString::Format("h2uBlack_%d", int(it)), 10000, 0, 1000000, 1000, -500, 500));
-              h2lastDac.push_back(new TH2F(TString::Format("h2lastDac_%d", int(it)), TString::Format("h2lastDac_%d", int(it)), 10000, 0, 1000000, 1000, -500, 500));
+              hEncode.push_back(Detached(new TH1F(TString::Format("encoded_%d", int(it)), TString::Format("encoded_%d", int(it)), 1000, -500, 500)));
+              hUblack.push_back(Detached(new TH1F(TString::Format("uBlack_%d", int(it)), TString::Format("uBlack_%d", int(it)), 1000, -500, 500)));
+              hBlack.push_back(Detached(new TH1F(TString::Format("black_%d", int(it)), TString::Format("black_%d", int(it)), 1000, -500, 500)));
+              hc0.push_back(Detached(new TH1F(TString::Format("c0_%d", int(it)), TString::Format("c0_%d", int(it)), 1000, -500, 500)));
+              hc1.push_back(Detached(new TH1F(TString::Format("c1_%d", int(it)), TString::Format("c1_%d", int(it)), 1000, -500, 500)));
+              hr0.push_back(Detached(new TH1F(TString::Format("r0_%d", int(it)), TString::Format("r0_%d", int(it)), 1000, -500, 500)));
+              hr1.push_back(Detached(new TH1F(TString::Format("r1_%d", int(it)), TString::Format("r1_%d", int(it)), 1000, -500, 500)));
+              hcr.push_back(Detached(new TH1F(TString::Format("cr_%d", int(it)), TString::Format("cr_%d", int(it)), 1000, -500, 500)));
+              pblack.push_back(Detached(new TProfile(TString::Format("pblack_%d", int(it)), TString::Format("pblack_%d", int(it)), 10000, 0, 1000000, -500, 500)));
+              pUblack.push_back(Detached(new TProfile(TString::Format("pUblack_%d", int(it)), TString::Format("pUblack_%d", int(it)), 10000, 0, 1000000, -500, 500)));
+              h2c0.push_back(Detached(new TH2F(TString::Format("h2c0_%d", int(it)), TString::Format("h2c0_%d", int(it)), 10000, 0, 1000000, 1000, -500, 500)));
+              h2c1.push_back(Detached(new TH2F(TString::Format("h2c1_%d", int(it)), TString::Format("h2c1_%d", int(it)), 10000, 0, 1000000, 1000, -500, 500)));
+              h2r0.push_back(Detached(new TH2F(TString::Format("h2r0_%d", int(it)), TString::Format("h2r0_%d", int(it)), 10000, 0, 1000000, 1000, -500, 500)));
+              h2r1.push_back(Detached(new TH2F(TString::Format("h2r1_%d", int(it)), TString::Format("h2r1_%d", int(it)), 10000, 0, 1000000, 1000, -500, 500)));
+              h2cr.push_back(Detached(new TH2F(TString::Format("h2cr_%d", int(it)), TString::Format("h2cr_%d", int(it)), 10000, 0, 1000000, 1000, -500, 500)));
+              h2black.push_back(Detached(new TH2F(TString::Format("h2black_%d", int(it)), TString::Format("h2black_%d", int(it)), 10000, 0, 1000000, 1000, -500, 500)));
+              h2uBlack.push_back(Detached(new TH2F(TString::Format("h2uBlack_%d", int(it)), TString::Format("h2uBlack_%d", int(it)), 10000, 0, 1000000, 1000, -500, 500)));
+              h2lastDac.push_back(Detached(new TH2F(TString::Format("h2lastDac_%d", int(it)), TString::Format("h2lastDac_%d", int(it)), 10000, 0, 1000000, 1000, -500, 500)));
           }
       }
-        uBlackV = new std::vector<float>();
-        blackV = new std::vector<float>();
-        levelSV = new std::vector<int16_t>();
-        decodingOffsetVector2 = new std::vector<float>();
-        uBlackV->resize(16, 0.);
-        blackV->resize(16, 0.);
-        levelSV->resize(16, 0);
-        decodingOffsetVector2->resize(16, 0.);
+        uBlackV.assign(16, 0.);
+        blackV.assign(16, 0.);
+        levelSV.assign(16, 0);
+        decodingOffsetVector2.assign(16, 0.);
         for(size_t it = 0; it < decodingOffsetVector.size(); it++)
-            decodingOffsetVector2->at(it) = decodingOffsetVector[it];
+            decodingOffsetVector2.at(it) = decodingOffsetVector[it];
+        BuildPipe();
+    }
+
+    /** Wires up a new decoder chain with the current run settings */
+    CMSPixelPipe & BuildPipe() const {
+      m_pipe.pipe.reset(new CMSPixelPipe);
+      CMSPixelPipe & p = *m_pipe.pipe;
+      p.src = evtSource(0, m_nplanes, 0, m_tbmtype, m_roctype);
+      p.decoder.setLevel1s(level1Vector);
+      p.decoder.setAlphas(decodingAlphasVector);
+      p.decoder.setBlackOffsets(decodingOffsetVector);
+      p.decoder.SetBlackVectors(uBlackV, blackV, levelSV, decodingOffsetVector2);
+      p.src >> p.splitter >> p.decoder >> p.pump;
+      return p;
+    }
+
+    /** Adds the statistics and header levels of the current decoder chain to the totals and drops it */
+    void RetirePipe() const {
+      if (!m_pipe.pipe) return;
+      decoding_stats += m_pipe.pipe->decoder.getStatistics();
+      UpdateHeaderVectors(m_pipe.pipe->decoder, &uBlackV, &blackV, &levelSV, &decodingOffsetVector2);
+      m_pipe.pipe.reset();
     }
 
     void WriteDecoding() {
@@ -262,11 +295,13 @@ struct VCALDict {
     std::string GetStats() {
       std::cout << "Getting decoding statistics for detector " << m_detector << std::endl;
       if (do_decoding) { WriteDecoding(); }
+      RetirePipe();
       return decoding_stats.getString();
     }
 
     void read_PHCalibrationData(const Configuration & cnf){
       std::cout << "TRY TO READ PH CALIBRATION DATA... ";
+      ph_calibration.Clear();
       bool foundData;
       for (auto i: cnf.GetSections()){
         if (i.find("Producer.")==-1) continue;
@@ -275,7 +310,7 @@ struct VCALDict {
         if (roctype == "") continue;
         bool is_digital = !(roctype.find("dig") == -1);
 
-        std::string fname = m_conv_cfg->GetKeys().size() > 0 ? m_conv_cfg->Get("phCalibrationFile", "") : "";
+        std::string fname = m_conv_cfg.GetKeys().size() > 0 ? m_conv_cfg.Get("phCalibrationFile", "") : "";
         if (fname == "") fname = cnf.Get("phCalibrationFile","");
         if (fname == "") {
           fname = cnf.Get("dacFile", "");
@@ -337,9 +372,11 @@ struct VCALDict {
             tmp_vcaldict.par2 = par2;
             tmp_vcaldict.par3 = par3;
             tmp_vcaldict.calibration_factor = factor;
-            std::string identifier = roc_type + std::string( TString::Format("%01d%02d%02d",iroc,row,col));
+            tmp_vcaldict.row = row;
+            tmp_vcaldict.col = col;
             q++;
-            vcal_vals[identifier] = tmp_vcaldict;
+            // only the calibration of our own detector is used
+            if (roc_type == m_detector) ph_calibration.Set(iroc, col, row, tmp_vcaldict);
           }
           fclose(fp);
         }
@@ -347,11 +384,11 @@ struct VCALDict {
       return true;
     }
 
-      void UpdateHeaderVectors(dtbEventDecoder decoder, std::vector<float> *tvectUB, std::vector<float> *tvectB, std::vector<int16_t> *tvectLS, std::vector<float> *tvectDOff) const {
-          std::vector<float> tempUB = decoder.GetUBlack();
-          std::vector<float> tempB = decoder.GetBlack();
-          std::vector<int16_t> tempLS = decoder.GetLevelS();
-          std::vector<float> tempDOFF = decoder.GetDecodingOffsets();
+      static void UpdateHeaderVectors(dtbEventDecoder & decoder, std::vector<float> *tvectUB, std::vector<float> *tvectB, std::vector<int16_t> *tvectLS, std::vector<float> *tvectDOff) {
+          const std::vector<float> & tempUB = decoder.GetUBlack();
+          const std::vector<float> & tempB = decoder.GetBlack();
+          const std::vector<int16_t> & tempLS = decoder.GetLevelS();
+          const std::vector<float> & tempDOFF = decoder.GetDecodingOffsets();
           for(size_t it = 0; it < tempUB.size() and it < tvectUB->size(); it++)
               (*tvectUB).at(it) = tempUB[it];
           for(size_t it = 0; it < tempB.size() and it < tvectB->size(); it++)
@@ -454,6 +491,7 @@ struct VCALDict {
           }
         std::cout << "Decoding statistics for detector " << m_detector << std::endl;
         pxar::Log::ReportingLevel() = pxar::Log::FromString("INFO");
+        RetirePipe();
         decoding_stats.dump();
           return true;
       }
@@ -483,30 +521,17 @@ struct VCALDict {
       pxar::Log::ReportingLevel() = pxar::Log::FromString("CRITICAL");
       //pxar::Log::ReportingLevel() = pxar::Log::FromString("DEBUGPIPES");
 
-      // The pipeworks:
-      evtSource src;
-      passthroughSplitter splitter;
-      dtbEventDecoder decoder;
-      decoder.setLevel1s(std::vector<float>(level1Vector.begin(), level1Vector.end()));
-      decoder.setAlphas(std::vector<float>(decodingAlphasVector.begin(), decodingAlphasVector.end()));
-      decoder.setBlackOffsets(decodingOffsetVector);
-      decoder.SetBlackVectors(*uBlackV, *blackV, *levelSV, *decodingOffsetVector2);
-      dataSink<pxar::Event*> Eventpump;
+      // The pipeworks, set up once per run (or after a failed event):
+      CMSPixelPipe & pipe = m_pipe.pipe ? *m_pipe.pipe : BuildPipe();
+      dtbEventDecoder & decoder = pipe.decoder;
       pxar::Event* evt ;
-        int n=0;
         try{
 
-            // Connect the data source and set up the pipe:
-            src = evtSource(0, m_nplanes, 0, m_tbmtype, m_roctype);
-            src >> splitter >> decoder >> Eventpump;
-
             // Transform from EUDAQ data, add it to the datasource:
-            src.AddData(TransformRawData(in_raw.GetBlock(0)));
+            pipe.src.AddData(TransformRawData(in_raw.GetBlock(0)));
             // ...and pull it out at the other end:
-            evt = Eventpump.Get();
+            evt = pipe.pump.Get();
 
-            decoding_stats += decoder.getStatistics();
-            UpdateHeaderVectors(decoder, uBlackV, blackV, levelSV, decodingOffsetVector2);
           if(do_decoding) {
               for (size_t roc = 0; roc < m_nplanes; roc++) {
                   std::vector<int16_t> tempc0 = decoder.Getc0Vect(roc);
@@ -562,6 +587,8 @@ struct VCALDict {
       }
       catch (std::exception& e){
           EUDAQ_WARN("Decoding crashed at event (" + m_detector + ") " + to_string(in.GetEventNumber()) + ":");
+          // the chain may be left in the middle of an event, start the next one with a fresh one
+          RetirePipe();
           std::ofstream f;
           std::string runNumber = to_string(in.GetRunNumber());
           std::string filename = "Errors" + std::string(3 - runNumber.length(), '0') + runNumber + ".txt";
@@ -583,20 +610,18 @@ struct VCALDict {
 
         // Initialize the plane size (zero suppressed), set the number of pixels
         // Check which carrier PCB has been used and book planes accordingly:
-        if(m_rotated_pcb) { plane.SetSizeZS(ROC_NUMROWS, ROC_NUMCOLS, 0); }
-        else { plane.SetSizeZS(ROC_NUMCOLS, ROC_NUMROWS, 0); }
+        if(m_rotated_pcb) { plane.SetSizeZS(ROC_NUMROWS, ROC_NUMCOLS, 0, 1, StandardPlane::FLAG_COMPACT); }
+        else { plane.SetSizeZS(ROC_NUMCOLS, ROC_NUMROWS, 0, 1, StandardPlane::FLAG_COMPACT); }
         plane.SetTLUEvent(0);
 
         // Store all decoded pixels belonging to this plane:
         for(std::vector<pxar::pixel>::iterator it = evt->pixels.begin(); it != evt->pixels.end(); ++it){
           // Check if current pixel belongs on this plane:
           if(it->roc() == roc) {
-            std::string identifier = (std::string)m_detector+(std::string)TString::Format("%01zu%02d%02d",roc,it->row(),it->column());
-
             float charge;
             if (do_conversion){
-                charge = getCharge(vcal_vals.find(identifier)->second, it->value());
-                if (charge < 0){
+                charge = ph_calibration.Charge(roc, it->column(), it->row(), it->value());
+                if (!(charge >= 0)){
                   EUDAQ_WARN(std::string("Invalid cluster charge -" + to_string(charge) +  "/" + to_string(it->value())));
                   charge = 0;
                 }
@@ -611,7 +636,7 @@ struct VCALDict {
         }
 
         // Add plane to the output event:
-        out.AddPlane(plane);
+        out.AddPlane(std::move(plane));
       }
       return true;
     }
@@ -732,14 +757,23 @@ struct VCALDict {
     std::string m_detector;
     bool m_rotated_pcb;
     std::string m_event_type;
-    mutable pxar::statistics decoding_stats;
+    mutable pxar::statistics decoding_stats;   ///< of the retired decoder chains
+    mutable CMSPixelPipeHolder m_pipe;
     bool do_conversion;
     bool do_decoding;
-    Configuration * m_conv_cfg;
+    Configuration m_conv_cfg;
     std::vector<float> decodingOffsetVector;
     std::vector<float> decodingAlphasVector;
     std::vector<float> level1Vector;
 
+    /** The histograms are owned by the helper and written explicitly, so they are kept out of ROOT's current
+     *  directory: the copies book histograms with the same names, and closing a file must not delete them */
+    template <typename H>
+    static H * Detached(H * h) {
+      h->SetDirectory(0);
+      return h;
+    }
+
     static std::vector<uint16_t> TransformRawData(const std::vector<unsigned char> & block) {
       /** Transform data of form char* to vector<int16_t> */
       std::vector<uint16_t> rawData;
@@ -38,6 +38,8 @@ class Configuration;
       virtual void OnIdle();
       virtual void OnClear();
       virtual void OnUnrecognised(const std::string & /*cmd*/, const std::string & /*param*/) {}
+      /** Called after OnStatus, for tags that a base class adds on behalf of all its subclasses */
+      virtual void AddStatusTags() {}
 
       void Process(int timeout);
       void CommandThread();
@@ -4,7 +4,7 @@
 //#include <pthread.h>
 #include <string>
 #include <vector>
-#include <list>
+#include <unordered_map>
 
 #include "eudaq/TransportServer.hh"
 #include "eudaq/CommandReceiver.hh"
@@ -14,6 +14,9 @@
 #include "eudaq/Utils.hh"
 #include "eudaq/Platform.hh"
 #include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 namespace eudaq {
 
@@ -40,15 +43,56 @@ namespace eudaq {
       virtual ~DataCollector();
 
       void DataThread();
+      void WriterThread();
     private:
+      struct Entry {
+        std::shared_ptr<Event> ev;
+        double time; ///< arrival time [s]
+        size_t bytes;
+      };
+      /** Fixed-capacity FIFO of the events received from one producer */
+      class Ring {
+        public:
+          Ring() : m_head(0), m_size(0) {}
+          void reset(size_t capacity) { m_data.clear(); m_data.resize(capacity); m_head = m_size = 0; }
+          size_t size() const { return m_size; }
+          size_t capacity() const { return m_data.size(); }
+          bool empty() const { return m_size == 0; }
+          bool full() const { return m_size >= m_data.size(); }
+          Entry & front() { return m_data[m_head]; }
+          void push(const Entry & e) { m_data[(m_head + m_size++) % m_data.size()] = e; }
+          void pop() { m_data[m_head].ev.reset(); m_head = (m_head + 1) % m_data.size(); --m_size; }
+          void clear() { while (m_size) pop(); m_head = 0; }
+        private:
+          std::vector<Entry> m_data;
+          size_t m_head, m_size;
+      };
       struct Info {
-       std::shared_ptr<ConnectionInfo> id;
-        std::list<std::shared_ptr<Event> > events;
+        std::shared_ptr<ConnectionInfo> id;
+        std::string name;
+        Ring events;
+        bool closed; ///< disconnected, removed once its events are built
+        uint64_t n_received, n_missing; ///< events received, incomplete events built without this producer
+        size_t peak;
+        unsigned last; ///< event number of the last event received
       };
 
       const std::string m_runnumberfile; // path to the file containing the run number
       void DataHandler(TransportEvent & ev);
+      size_t FindInfo(const ConnectionInfo & id);
       size_t GetInfo(const ConnectionInfo & id);
+      void Receive(size_t slot, const std::shared_ptr<Event> & ev, size_t bytes);
+      void BuildEvents();
+      void BuildEvent(const std::vector<char> & take, const char * reason);
+      const char * CheckAlignment();
+      const char * CheckPressure();
+      void RemoveClosed();
+      void WriteBuilt();
+      void WriteEvent(const std::shared_ptr<DetectorEvent> & ev);
+      void WriteFallback(const DetectorEvent & ev);
+      void StartWriter();
+      void StopWriter();
+      void DrainWriter();
 
       bool m_done, m_listening;
       TransportServer * m_dataserver; ///< Transport for receiving data packets
@@ -56,12 +100,39 @@ namespace eudaq {
 //       pthread_attr_t m_threadattr;
 	  std::unique_ptr<std::thread> m_thread;
       std::vector<Info> m_buffer;
+      std::unordered_map<size_t, size_t> m_slots; ///< ConnectionInfo::Hash() -> index in m_buffer
+      std::mutex m_buffer_mutex;
       size_t m_numwaiting; ///< The number of producers with events waiting in the buffer
       size_t m_itlu; ///< Index of TLU in m_buffer vector, or -1 if no TLU
+
+      /** event building: events are built as soon as every producer has one buffered,
+       *  incomplete events are built when a queue is full, the memory limit is reached or the oldest event timed out */
+      size_t m_queue_size, m_max_bytes, m_bytes;
+      size_t m_received_bytes; ///< size of the packet handed to OnReceive by the data thread
+      double m_timeout; ///< [s], 0 = wait forever
+      int m_max_mismatch; ///< event number difference that triggers a resync, -1 = only warn
+      uint64_t m_n_incomplete;
+      std::vector<char> m_take;
+      std::vector<std::shared_ptr<DetectorEvent> > m_built, m_writing;
       unsigned m_runnumber, m_eventnumber;
       std::shared_ptr<FileWriter> m_writer;
       Configuration m_config;
       Time m_runstart;
+
+      /** asynchronous writing: complete events are queued and written by m_writer_thread */
+      bool m_async, m_writer_done, m_overflow;
+      std::unique_ptr<std::thread> m_writer_thread;
+      std::vector<std::shared_ptr<DetectorEvent> > m_queue; ///< front buffer, swapped out by the writer thread
+      size_t m_n_queued; ///< events queued or being written
+      size_t m_queue_high, m_queue_low; ///< watermarks for back-pressure
+      std::mutex m_queue_mutex;
+      std::condition_variable m_cv_queue, m_cv_space;
+      std::shared_ptr<FileWriter> m_fallback; ///< raw writer used while the queue is overflowing
+      std::string m_fallback_type;
+      bool m_fallback_started;
+      std::shared_ptr<DetectorEvent> m_bore;
+      size_t m_queue_peak, m_n_blocked, m_n_overflows, m_n_fallback;
+      double m_blocked_time;
   };
 
 }
@@ -188,6 +188,12 @@ namespace eudaq{
       virtual void set_conversion(bool val) {};
       virtual bool get_conversion(){return false;}
 
+      /** Returns a new copy of the plugin for another thread or context, which is not registered
+       *  at the global plugin manager (see PluginManager::Clone), or 0 if the plugin has no per-run
+       *  state and can be shared. The copy has to be initialised with the BORE before it is used.
+       */
+      virtual DataConverterPlugin * Clone() const { return 0; }
+
     protected:
       /** The string storing the event type this plugin can convert to lcio.
        *  This string has to be set in the constructor of the actual implementations
@@ -202,13 +208,14 @@ namespace eudaq{
       DataConverterPlugin(std::string subtype);
       DataConverterPlugin(unsigned type, std::string subtype = "");
 
+      /** The copy constructor only copies the event type and does not register the copy,
+       *  it's used by the implementations of Clone().
+       */
+      DataConverterPlugin(const DataConverterPlugin & other) : m_eventtype(other.m_eventtype) {}
+
     private:
-      /** The private copy constructor and assignment operator. They are not used anywhere, so there is not
-       *  even an implementation. Even if the childs default copy constructor is public
-       *  the code will not compile if it is called, since it cannot acces this cc, which the
-       *  the default cc does.
+      /** The private assignment operator. It is not used anywhere, so there is not even an implementation.
        */
-      DataConverterPlugin(DataConverterPlugin &);
       DataConverterPlugin & operator = (const DataConverterPlugin &);
   };
 
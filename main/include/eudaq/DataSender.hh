@@ -4,12 +4,20 @@
 
 #include "eudaq/Platform.hh"
 #include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 namespace eudaq {
 
 class TransportClient;
 class Event;
 class AidaPacket;
+class Configuration;
+class Status;
 
   class DLLEXPORT DataSender {
     public:
@@ -18,9 +26,50 @@ class AidaPacket;
       void Connect(const std::string & server);
       void SendEvent(const Event &);
       void SendPacket(const AidaPacket &);
+
+      /** Opt-in batching: events are serialized into batches which a background thread sends
+       *  once they hold max_events events or max_bytes bytes, or max_delay_ms after their first event.
+       *  BOREs and EOREs are sent right away, SendEvent returns after an EORE has been sent.
+       *  max_events = 0 sends every event on its own again.
+       */
+      void SetBatching(size_t max_events, unsigned max_delay_ms = 10, size_t max_bytes = 1 << 20);
+      /** Reads BatchEvents (default 0 = off), BatchDelay [ms] and BatchBytes */
+      void SetBatching(const Configuration & conf);
+      /** Waits until all batched events have been sent */
+      void FlushBatch();
+      /** Adds the send counters (throughput since the last call, queue depth) to the status */
+      void FillStatus(Status & status);
+
+      /** Splits a received packet into the events of a batch, returns false if it is a single event */
+      static bool SplitBatch(const unsigned char * data, size_t len, std::vector<std::pair<const unsigned char *, size_t> > & events);
     private:
+      void SendBatch(std::vector<unsigned char> & batch);
+      void SealBatch();
+      void StopSender();
+      void SenderThread();
       std::string m_type, m_name;
       TransportClient * m_dataclient;
+
+      size_t m_batch_events, m_batch_bytes;
+      unsigned m_batch_delay;
+      std::unique_ptr<std::thread> m_sender;
+      bool m_stop_sender;
+      bool m_batching;                                 ///< a sender thread takes events, guarded by m_mutex
+      std::mutex m_mutex;
+      std::mutex m_send_mutex;                         ///< serializes the use of m_dataclient, taken after m_mutex
+      std::condition_variable m_cv_work, m_cv_done;
+      std::vector<unsigned char> m_open;              ///< batch being filled
+      size_t m_open_events;
+      double m_open_time;
+      std::deque<std::vector<unsigned char> > m_sealed; ///< batches waiting to be sent
+      std::vector<std::vector<unsigned char> > m_free;  ///< sent batches, reused as arenas
+      bool m_sending;
+
+      // counters
+      uint64_t m_n_events, m_n_bytes, m_n_batches, m_n_errors;
+      size_t m_queued, m_queue_peak;
+      uint64_t m_last_events, m_last_bytes;
+      double m_last_time;
   };
 
 }
@@ -37,6 +37,7 @@ namespace eudaq{
 	 void event_queue_pop_TLU_event();
 	 void makeDetectorEvent();
 	 void clearDetectorQueue();
+	 void clearQueues();
 
       /** The empty destructor. Need to add it to make it virtual.
        */
@@ -0,0 +1,57 @@
+#ifndef EUDAQ_INCLUDED_FileIndex
+#define EUDAQ_INCLUDED_FileIndex
+
+#include <string>
+#include <vector>
+#include "eudaq/Platform.hh"
+
+#if ((defined WIN32) && (defined __CINT__))
+typedef unsigned long long uint64_t
+#else
+#include <cstdint>
+#endif
+
+namespace eudaq {
+
+  class Event;
+
+  /** Byte offsets of the events in a native (.raw) file, kept next to it in <file>.idx.
+   *  The index stores the size of the raw file it was built from, so an index of a
+   *  file that has grown since is recognised as stale.
+   */
+  class DLLEXPORT FileIndex {
+    public:
+      struct Entry {
+        unsigned event;
+        uint64_t offset;
+        uint64_t timestamp;
+        unsigned flags; ///< BORE/EORE flags of the event
+      };
+      explicit FileIndex(const std::string & rawfile);
+      static std::string IndexName(const std::string & rawfile) { return rawfile + ".idx"; }
+
+      /** Reads the index file, returns false if it doesn't exist or is stale. */
+      bool Load();
+      /** Writes the index file, returns false if that was not possible (e.g. read-only directory). */
+      bool Save();
+      /** Scans the whole raw file. */
+      void Build();
+      void Add(const Event & ev, uint64_t offset);
+      void Clear() { m_entries.clear(); m_complete = false; m_filesize = 0; }
+      bool Complete() const { return m_complete; }
+      /** True if the raw file has changed size since the index was built from it. */
+      bool Stale() const { return RawFileSize() != m_filesize; }
+      /** Returns the (non-BORE, non-EORE) entry of the event, or 0 if it is not in the file. */
+      const Entry * Find(unsigned event) const;
+      const std::vector<Entry> & Entries() const { return m_entries; }
+    private:
+      uint64_t RawFileSize() const;
+      std::string m_rawfile;
+      std::vector<Entry> m_entries;
+      bool m_complete;
+      uint64_t m_filesize; ///< size of the raw file the entries cover
+  };
+
+}
+
+#endif // EUDAQ_INCLUDED_FileIndex
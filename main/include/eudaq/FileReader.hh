@@ -4,6 +4,7 @@
 #include "eudaq/FileSerializer.hh"
 #include "eudaq/DetectorEvent.hh"
 #include "eudaq/StandardEvent.hh"
+#include "eudaq/FileIndex.hh"
 
 #include <string>
 
@@ -14,10 +15,16 @@ namespace eudaq {
 
   class DLLEXPORT FileReader {
     public:
-      FileReader(const std::string & filename, const std::string & filepattern = "");
+      /** With mapped the file is memory-mapped (it must not be written to anymore) */
+      FileReader(const std::string & filename, const std::string & filepattern = "", bool mapped = false);
 
       ~FileReader();
       bool NextEvent(size_t skip = 0);
+      /** Jumps to event n using the event index, which is built if the file
+       *  doesn't have an up to date one. Returns false if the file has no event n.
+       */
+      bool SeekEvent(unsigned n);
+      const FileIndex & GetIndex() const { return m_index; }
       std::string Filename() const { return m_filename; }
       unsigned RunNumber() const;
       const eudaq::Event & GetEvent() const;
@@ -32,6 +39,8 @@ namespace eudaq {
       FileDeserializer m_des;
      std::shared_ptr<eudaq::Event> m_ev;
       unsigned m_ver;
+      FileIndex m_index;
+      bool m_indexing; ///< the index is recorded while the file is read sequentially
 
   };
  
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <cstdio>
+#include <vector>
 #include "eudaq/Serializer.hh"
 #include "eudaq/Exception.hh"
 #include "eudaq/BufferSerializer.hh"
@@ -11,20 +12,48 @@ namespace eudaq {
 	class Event;
   class DLLEXPORT FileSerializer : public Serializer {
     public:
-      FileSerializer(const std::string & fname, bool overwrite = false);
+      /** With buffersize > 0 all data is kept in a user-space buffer which is only
+       *  written out at record boundaries (see Commit), so the file never ends in a partial event.
+       */
+      FileSerializer(const std::string & fname, bool overwrite = false, size_t buffersize = 0);
+      /** Writes out all committed records, a record still being serialized stays in the buffer (and is dropped on destruction). */
       virtual void Flush();
+      /** Marks the end of a complete record (event) and flushes if the flush policy is due. */
+      void Commit();
+      /** Flush after n records, t milliseconds or m bytes since the last flush (0 disables the criterion). */
+      void SetFlushPolicy(size_t n_records, unsigned t_ms = 0, uint64_t n_bytes = 0);
       uint64_t FileBytes() const { return m_filebytes; }
+      /** Number of flushes per latency bin, bin i counts flushes taking [2^(i-1), 2^i) us. */
+      const std::vector<uint64_t> & FlushLatencies() const { return m_flush_hist; }
+      std::string FlushStats() const;
       ~FileSerializer();
     private:
       virtual void Serialize(const unsigned char * data, size_t len);
+      void WriteBuffer(size_t len);
       FILE * m_file;
       uint64_t m_filebytes;
+      std::vector<unsigned char> m_buf;
+      size_t m_bufsize, m_committed;
+      size_t m_flush_records, m_n_records;
+      unsigned m_flush_ms;
+      uint64_t m_flush_bytes, m_lastflush_bytes;
+      double m_lastflush_time;
+      std::vector<uint64_t> m_flush_hist;
   };
 
   class DLLEXPORT FileDeserializer : public Deserializer {
     public:
-      FileDeserializer(const std::string & fname, bool faileof = false, size_t buffersize = 65536);
+      /** With mapped the whole file is memory-mapped instead of read through a buffer.
+       *  The file must then be complete, i.e. it can't be used to follow a file that is still being written.
+       */
+      FileDeserializer(const std::string & fname, bool faileof = false, size_t buffersize = 65536, bool mapped = false);
       virtual bool HasData();
+      virtual const unsigned char * View(size_t len, std::shared_ptr<const void> & source);
+      bool IsMapped() const { return m_map.get() != 0; }
+      /** File offset of the next byte to be read */
+      uint64_t Tell();
+      void Seek(uint64_t offset);
+      ~FileDeserializer();
       template <typename T>
         T peek() {
           FillBuffer();
@@ -43,6 +72,8 @@ namespace eudaq {
       bool m_faileof;
       std::vector<unsigned char> m_buf;
       ptr_t m_start, m_stop;
+      struct MappedFile;
+      std::shared_ptr<MappedFile> m_map;
   };
   
 }
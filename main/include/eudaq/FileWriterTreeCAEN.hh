@@ -62,8 +62,8 @@ namespace eudaq {
         bool UseWaveForm(uint16_t bitmask, uint8_t iwf) { return ((bitmask & 1 << iwf) == 1 << iwf); }
         std::string GetBitMask(uint16_t bitmask);
         std::string GetPolarities(std::vector<signed char> pol);
-        void SetTimeStamp(StandardEvent);
-        void SetBeamCurrent(StandardEvent);
+        void SetTimeStamp(const StandardEvent &);
+        void SetBeamCurrent(const StandardEvent &);
         void ReadIntegralRanges();
         void ReadIntegralRegions();
         float GetRFPhase(float, float);
@@ -135,6 +135,7 @@ namespace eudaq {
         // integrals
         std::map<uint8_t, std::map<std::string, std::pair<float, float> *> > ranges;
         std::map<int, WaveformSignalRegions *> *regions;
+        waveform::PrefixSums sums;  ///< of the waveform whose regions are being evaluated
         std::vector<std::string> *IntegralNames;
         std::vector<float> *IntegralValues;
         std::vector<float> *TimeIntegralValues;
@@ -10,6 +10,8 @@
 #include "PluginManager.hh"
 #include "Logger.hh"
 #include "FileSerializer.hh"
+#include "TimeCalibration.hh"
+#include "WaveformFFT.hh"
 #include "WaveformSignalRegion.hh"
 #include "WaveformSignalRegions.hh"
 #include "include/SimpleStandardEvent.hh"
@@ -31,9 +33,16 @@
 #include "TMath.h"
 #include "TString.h"
 #include "TROOT.h"
+#include "TThread.h"
+#include "RVersion.h"
 #include <Math/MinimizerOptions.h>
 #include "TDirectory.h"
 
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
 namespace eudaq {
 
     class FileWriterTreeDRS4 : public FileWriter {
@@ -55,41 +64,166 @@ namespace eudaq {
         virtual void setTU(bool tu) { hasTU = tu; }
 
     private:
+        /** All per-event quantities of the waveform analysis. The analysis of one event only writes into its own
+         *  EventData and into the Worker it runs on, so that several events can be analysed at the same time.
+         *  The results are swapped into the branch buffers in event order before the tree is filled. */
+        struct EventData {
+            EventData();
+            void Clear();
+            void Resize(size_t n_channels);
+            StandardEvent sev;
+            uint64_t index;
+            std::exception_ptr error; ///< thrown by the analysis, the event is not written
+            // filled in reading order
+            int event_number;
+            double time;
+            uint16_t beam_current;
+            std::vector<uint64_t> scaler;
+            std::vector<std::pair<float, float> > noise;
+            // filled by the analysis
+            uint16_t trigger_cell;
+            int pulser;
+            std::vector<uint16_t> forc_pos;
+            std::vector<float> forc_time;
+            std::vector<float> integral_values;
+            std::vector<float> time_integral_values;
+            std::vector<Int_t> integral_peaks;
+            std::vector<float> integral_peak_time;
+            std::vector<float> integral_length;
+            std::vector<float> cft;
+            std::vector<bool> is_saturated;
+            std::vector<bool> is_da;
+            std::vector<float> median;
+            std::vector<float> average;
+            std::vector<uint16_t> max_peak_position;
+            std::vector<float> max_peak_time;
+            std::vector<std::vector<uint16_t> > peak_positions;
+            std::vector<std::vector<float> > peak_times;
+            std::vector<uint8_t> npeaks;
+            std::vector<float> rise_time;
+            std::vector<float> fall_time;
+            std::vector<float> wf_start;
+            std::vector<float> fit_peak_time;
+            std::vector<float> fit_peak_value;
+            std::vector<float> peaking_time;
+            std::vector<std::vector<uint16_t> > peaks_x;
+            std::vector<std::vector<float> > peaks_x_time;
+            std::vector<std::vector<float> > peaks_y;
+            int n_peaks_total;
+            int n_peaks_before_roi;
+            int n_peaks_after_roi;
+            std::vector<std::vector<float> > fft_values;
+            std::vector<std::vector<float> > fft_modes;
+            std::vector<float> fft_mean;
+            std::vector<float> fft_mean_freq;
+            std::vector<float> fft_max;
+            std::vector<float> fft_max_freq;
+            std::vector<float> fft_min;
+            std::vector<float> fft_min_freq;
+            std::vector<uint16_t> plane;
+            std::vector<uint16_t> col;
+            std::vector<uint16_t> row;
+            std::vector<int16_t> adc;
+            std::vector<uint32_t> charge;
+        };
+
+        /** Analysis tools which keep state between calls and therefore exist once per thread. */
+        struct Worker {
+            Worker();
+            ~Worker();
+            TSpectrum *spec;
+            WaveformFFT fft;  ///< all fft channels of an event in one batch
+            std::vector<float> data_pos;
+            std::vector<float> decon;
+            waveform::PrefixSums sums;  ///< of the waveform whose regions are being evaluated
+            TStopwatch w_spectrum;
+            TStopwatch w_fft;
+            std::thread thread;
+        };
+
+        /** The signal regions and integrals of the config, compiled once in Configure() into flat arrays in the
+         *  order of the integral branches, so that the per-event evaluation needs no name lookups. */
+        struct IntegralPlan {
+            enum Kind : uint8_t { INTEGRAL, PEAKTOPEAK, MEDIAN };
+            struct Region {
+                uint8_t channel;
+                signed char polarity;
+                uint16_t low, high;
+                int cft;             ///< index in the cft branch for the signal region, -1 otherwise
+                size_t first, last;  ///< integrals [first, last) of the region
+            };
+            void Clear();
+            std::vector<Region> regions;           ///< sorted by channel
+            std::vector<Kind> kinds;
+            std::vector<int> down, up;             ///< integral range around the peak position
+            std::map<uint8_t, size_t> signal_region;  ///< index of the "signal_b" region of each channel
+        };
+
         unsigned runnumber;
         TH1F *histo;
         long max_event_number;
         uint16_t save_waveforms;
         uint16_t active_regions;
-        void ClearVectors();
-        void ResizeVectors(size_t n_channels);
+        uint16_t fast_fit_waveforms; ///< closed-form leading edge and parabolic peak instead of the Minuit fits
+        uint16_t gauss_fit_waveforms; ///< as fast_fit_waveforms, with the parabola through the log of the samples
         int IsPulserEvent(const StandardWaveform *wf);
-        void ExtractForcTiming(std::vector<float> *);
-        void FillRegionIntegrals(const StandardEvent sev);
-        void FillRegionVectors();
-        void FillTotalRange(uint8_t iwf, const StandardWaveform *wf);
-        void UpdateWaveforms(uint8_t iwf);
-        void FillSpectrumData(uint8_t iwf);
-        void DoSpectrumFitting(uint8_t iwf);
-        void DoFFTAnalysis(uint8_t iwf);
+        void ExtractForcTiming(EventData &, const std::vector<float> &);
+        void FillRegionIntegrals(EventData &, Worker &);
+        void FillTotalRange(EventData &, Worker &, uint8_t iwf, const StandardWaveform *wf);
+        void UpdateWaveforms(uint8_t iwf, const std::vector<float> &);
+        void FillSpectrumData(Worker &, uint8_t iwf, const std::vector<float> &);
+        void DoSpectrumFitting(EventData &, Worker &, uint8_t iwf);
+        void DoFFTAnalysis(EventData &, Worker &);
         bool UseWaveForm(uint16_t bitmask, uint8_t iwf) { return ((bitmask & 1 << iwf) == 1 << iwf); }
         std::string GetBitMask(uint16_t bitmask);
         std::string GetPolarities(std::vector<signed char> pol);
-        void SetTimeStamp(StandardEvent);
-        void SetBeamCurrent(StandardEvent);
-        void SetScalers(StandardEvent);
+        void SetTimeStamp(EventData &);
+        void SetBeamCurrent(EventData &);
+        void SetScalers(EventData &);
         void ReadIntegralRanges();
         void ReadIntegralRegions();
+        void CompileIntegralPlan();
+        IntegralPlan plan;
         bool hasTU;
 
+        // event pipeline
+        void InitWorkers();
+        void StartThreads();
+        void StopThreads();
+        void Drain();
+        void RethrowError();
+        void PrepareEvent(EventData &);
+        void AnalyseEvent(EventData &, Worker &);
+        void CommitEvent(EventData &);
+        void WorkerLoop(Worker *);
+        void WriterLoop();
+        EventData * GetFreeEvent();
+        uint16_t n_threads;
+        size_t max_queued_events;
+        bool m_stop;
+        double m_time;
+        uint16_t m_beam_current;
+        uint64_t m_n_dispatched;
+        uint64_t m_n_committed;
+        int m_last_event_number;
+        std::vector<Worker *> m_workers;
+        std::vector<EventData *> m_free_events;
+        std::deque<EventData *> m_pending;
+        std::map<uint64_t, EventData *> m_analysed;
+        std::exception_ptr m_error; ///< first failed analysis, nothing is written after it
+        std::thread m_writer_thread;
+        std::mutex m_mutex;
+        std::mutex m_fit_mutex;
+        std::condition_variable m_cv_pending;
+        std::condition_variable m_cv_analysed;
+        std::condition_variable m_cv_committed;
+
         // clocks for checking execution time
-        TStopwatch w_spectrum;
-        TStopwatch w_fft;
         TStopwatch w_total;
         TFile *m_tfile; // book the pointer to a file (to store the output)
         TTree *m_ttree; // book the tree (to store the needed event info)
 
         int verbose;
-        std::vector<float> * data;
         std::vector<std::string> sensor_name;
         // Book variables for the Event_to_TTree conversion
         unsigned m_noe;
@@ -103,11 +237,11 @@ namespace eudaq {
 
         // drs4 timing calibration
         std::map<uint8_t, std::vector<float> > tcal;
-        std::map<uint8_t, std::vector<float> > full_time;
+        std::map<uint8_t, TimeCalibration> time_calibration;
 
         void FillFullTime();
-        inline float getTriggerTime(const uint8_t &ch, const uint16_t &bin);
-        float getTimeDifference(uint8_t ch, uint16_t bin_low, uint16_t bin_up);
+        inline float getTriggerTime(const uint8_t &ch, const uint16_t &bin, const uint16_t &trigger_cell);
+        float getTimeDifference(uint8_t ch, uint16_t bin_low, uint16_t bin_up, uint16_t trigger_cell);
 
         /** SCALAR BRANCHES */
         int f_nwfs;
@@ -134,6 +268,8 @@ namespace eudaq {
 
         uint16_t spectrum_waveforms;
         uint16_t fft_waveforms;
+        uint16_t fft_save_values;  ///< channels which store all bins in fft_values, not only fft_modes
+        size_t fft_n_modes;        ///< number of low modes in fft_modes, the highest mode is always added
         std::pair<uint16_t, uint16_t> pulser_region;
         int pulser_threshold;
         uint8_t pulser_channel;
@@ -185,21 +321,13 @@ namespace eudaq {
         TH1F *avgWF_3;
         TH1F *avgWF_3_pul;
         TH1F *avgWF_3_sig;
-        TSpectrum *spec;
-        TVirtualFFT *fft_own;
-        Int_t n_samples;
-        Double_t *re_full;
-        Double_t *im_full;
-        Double_t *in;
         TMacro *macro;
 
         // spectrum
         unsigned peak_noise_pos;
         std::vector<std::pair<float, float> >* noise;
         std::map<uint8_t, std::deque<float> *> noise_vectors;
-        void calc_noise(uint8_t);
-        std::vector<float> data_pos;
-        std::vector<float> decon;
+        void calc_noise(uint8_t, const std::vector<float> &);
         std::vector<std::vector<uint16_t> *> peaks_x;
         std::vector<std::vector<float> *> peaks_x_time;
         std::vector<std::vector<float> *> peaks_y;
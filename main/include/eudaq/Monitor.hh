@@ -41,6 +41,7 @@ namespace eudaq {
       unsigned int skip_events_with_counter;
       unsigned int counter_for_skipping;
       unsigned int start_event;
+      bool m_start_seeked;
   };
 
 }
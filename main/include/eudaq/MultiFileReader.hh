@@ -22,14 +22,20 @@ namespace eudaq{
 		 unsigned RunNumber() const;
 
 		bool NextEvent(size_t skip = 0);
+		/** Reads the next event whose number is in the sorted list, jumping over the others with the file index */
+		bool NextEvent(const std::vector<unsigned> & numbers);
+		/** Jumps to the first event with a number >= n in all files */
+		bool SeekEvent(unsigned n);
 		std::string Filename() const { return m_filename; }
 		   const DetectorEvent & GetDetectorEvent() const;
 		   const eudaq::Event & GetEvent() const;
+		   std::shared_ptr<eudaq::DetectorEvent> GetDetectorEvent_ptr() const { return m_ev; }
 	
-		void addFileReader(const std::string & filename, const std::string & filepattern = "");
+		void addFileReader(const std::string & filename, const std::string & filepattern = "", bool mapped = false);
 		void Interrupt() ;
 		bool hasTUEvent();
 	private:
+		bool SyncEvents(bool read);
 		std::string m_filename;
 		std::shared_ptr<eudaq::DetectorEvent> m_ev;
 		std::vector<std::shared_ptr<eudaq::FileReader>> m_fileReaders;
@@ -0,0 +1,61 @@
+#ifndef EUDAQ_INCLUDED_PHCalibration
+#define EUDAQ_INCLUDED_PHCalibration
+
+#include "eudaq/Platform.hh"
+#include <vector>
+#include <cstddef>
+
+namespace eudaq {
+
+  /** Erf fit of the pulse height calibration of one pixel: adc = par3 * (erf((vcal - par0) / par1) + par2) */
+  struct VCALDict {
+    int row;
+    int col;
+    float par0;
+    float par1;
+    float par2;
+    float par3;
+    float calibration_factor;
+  };
+
+  /** Pulse height calibrations of all pixels of a detector, stored densely as [roc][col][row].
+   *  The charge is the inverted fit times the calibration factor, optionally taken from a per-pixel table of all
+   *  integer ADC values.
+   */
+  class DLLEXPORT PHCalibration {
+    public:
+      enum { NCOLS = 52, NROWS = 80 };
+      PHCalibration() : m_n_rocs(0), m_n_adc(0) {}
+      /** Removes all calibrations and the lookup table */
+      void Clear();
+      /** Stores the fit of one pixel, growing the number of ROCs as needed */
+      void Set(size_t roc, int col, int row, const VCALDict & d);
+      bool Has(size_t roc, int col, int row) const { return Index(roc, col, row) < m_valid.size() and m_valid[Index(roc, col, row)]; }
+      bool Empty() const { return m_n_rocs == 0; }
+      /** Precomputes the charges of the ADC values [0, n_adc) for every calibrated pixel, 0 removes the table */
+      void BuildLUT(size_t n_adc);
+      /** Charge of the pixel for this pulse height, NaN for uncalibrated pixels */
+      float Charge(size_t roc, int col, int row, double adc) const {
+        size_t i = Index(roc, col, row);
+        if (i >= m_valid.size() or !m_valid[i]) return Uncalibrated();
+        if (adc >= 0 and adc < m_n_adc and size_t(adc) == adc) return m_lut[i * m_n_adc + size_t(adc)];
+        return Invert(m_pars[i], adc);
+      }
+      /** Same as TF1::GetX on the fit in [-4096, 4096] times the calibration factor; 0 where it has no solution */
+      static float Invert(const VCALDict & d, double adc);
+    private:
+      static size_t Index(size_t roc, int col, int row) {
+        if (col < 0 or col >= NCOLS or row < 0 or row >= NROWS) return size_t(-1);
+        return (roc * NCOLS + size_t(col)) * NROWS + size_t(row);
+      }
+      static float Uncalibrated();
+      size_t m_n_rocs;
+      size_t m_n_adc;
+      std::vector<VCALDict> m_pars;
+      std::vector<char> m_valid;
+      std::vector<float> m_lut;
+  };
+
+}
+
+#endif // EUDAQ_INCLUDED_PHCalibration
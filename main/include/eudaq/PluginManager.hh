@@ -6,6 +6,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 namespace eudaq {
 
@@ -31,6 +32,33 @@ namespace eudaq {
        */
       static PluginManager & GetInstance();
 
+      /** Creates a plugin manager for another thread or context. It holds clones of all plugins
+       *  implementing DataConverterPlugin::Clone() and shares the others with this manager.
+       *  Make it the thread's instance and initialise it with the BORE (SetConfig/Initialize)
+       *  before converting events with it.
+       */
+      PluginManager * Clone() const;
+
+      /** Makes manager the instance used by the static functions in the calling thread,
+       *  0 restores the global instance. The manager is not owned.
+       */
+      static void SetThreadInstance(PluginManager * manager);
+
+      /** Makes manager the thread's instance while the guard lives and restores the previous one
+       *  afterwards, also when an exception leaves the scope.
+       */
+      class DLLEXPORT ThreadInstanceGuard {
+        public:
+          explicit ThreadInstanceGuard(PluginManager * manager);
+          ~ThreadInstanceGuard();
+        private:
+          ThreadInstanceGuard(const ThreadInstanceGuard &);
+          ThreadInstanceGuard & operator=(const ThreadInstanceGuard &);
+          PluginManager * m_previous;
+      };
+
+      ~PluginManager();
+
       static unsigned GetTriggerID(const Event &);
       static int IsSyncWithTLU(eudaq::Event const & ev,eudaq::TLUEvent const & tlu);static t_eventid getEventId( eudaq::Event const & ev);
       static void setCurrentTLUEvent(eudaq::Event & ev,eudaq::TLUEvent const & tlu);
@@ -58,6 +86,8 @@ namespace eudaq {
     private:
       /** The map that correlates the event type with its converter plugin. */
       std::map<t_eventid, DataConverterPlugin *> m_pluginmap;
+      /** The cloned plugins, owned by this manager. */
+      std::vector<DataConverterPlugin *> m_clones;
 
       PluginManager() {}
       PluginManager(PluginManager const &) {}
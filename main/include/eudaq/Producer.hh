@@ -23,6 +23,8 @@ namespace eudaq {
       virtual ~Producer() {}
 
       virtual void OnData(const std::string & param);
+      /** Adds the DataSender counters */
+      virtual void AddStatusTags();
     private:
   };
 
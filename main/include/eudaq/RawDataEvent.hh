@@ -4,6 +4,8 @@
 #include <sstream>
 
 #include <vector>
+#include <memory>
+#include <mutex>
 #include "eudaq/Event.hh"
 #include "eudaq/Platform.hh"
 namespace eudaq {
@@ -16,13 +18,38 @@ namespace eudaq {
     public:
     typedef unsigned char byte_t;
     typedef std::vector<byte_t> data_t;
+    /// Read-only view on the bytes of a data block
+    struct DLLEXPORT data_view {
+      data_view(const byte_t * ptr = 0, size_t len = 0) : ptr(ptr), len(len) {}
+      const byte_t * data() const { return ptr; }
+      size_t size() const { return len; }
+      bool empty() const { return len == 0; }
+      const byte_t & operator [] (size_t i) const { return ptr[i]; }
+      const byte_t * begin() const { return ptr; }
+      const byte_t * end() const { return ptr + len; }
+      const byte_t * ptr;
+      size_t len;
+    };
     struct DLLEXPORT block_t : public Serializable {
       block_t(unsigned id = (unsigned)-1, data_t data = data_t()) : id(id), data(data) {}
       block_t(Deserializer &);
       void Serialize(Serializer &) const;
       void Append(const data_t & data);
+      /// Copy the referenced bytes into data if the block only references them
+      void Materialize();
+      data_view View() const { return source ? view : data_view(data.empty() ? 0 : &data[0], data.size()); }
+      /// The bytes as vector; referenced bytes are copied once, thread-safe, without changing the block
+      const data_t & Vector() const;
       unsigned id;
       data_t data;
+      data_view view; ///< bytes owned by source, e.g. a memory-mapped file
+      std::shared_ptr<const void> source;
+      /// Copy of the referenced bytes made by Vector()
+      struct ViewCopy {
+        std::once_flag once;
+        data_t data;
+      };
+      std::shared_ptr<ViewCopy> copy;
     };
 
     RawDataEvent(std::string type, unsigned run, unsigned event);
@@ -67,6 +94,10 @@ namespace eudaq {
      *  give different results depending on the endiannes of your mashine.
      */
     const data_t & GetBlock(size_t i) const;
+    /** Get the data block number i without copying it, if it references a
+     *  memory-mapped file. The view stays valid as long as the event exists.
+     */
+    data_view GetBlockView(size_t i) const { return m_blocks.at(i).View(); }
     byte_t GetByte(size_t block, size_t index) const;
 
     /// Return the number of data blocks in the RawDataEvent
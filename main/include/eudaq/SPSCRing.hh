@@ -0,0 +1,88 @@
+#ifndef EUDAQ_INCLUDED_SPSCRing
+#define EUDAQ_INCLUDED_SPSCRing
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+namespace eudaq {
+
+  /** Lock-free ring buffer handing preallocated slots from one producer thread to one consumer thread.
+   *  The producer fills back() and publishes it with push(), the consumer reads front() and frees it with pop().
+   *  A thread only takes the mutex when it has to sleep (wait_back/wait_front) or has to wake the other one.
+   */
+  template <typename T>
+  class SPSCRing {
+    public:
+      explicit SPSCRing(size_t capacity = 1) : m_head(0), m_tail(0), m_wait_data(false), m_wait_space(false) { reset(capacity); }
+
+      /** Resizes to the next power of two >= capacity, only while neither thread uses the ring */
+      void reset(size_t capacity) {
+        size_t n = 1;
+        while (n < capacity) n <<= 1;
+        m_slots.clear();
+        m_slots.resize(n);
+        m_head = m_tail = 0;
+      }
+      size_t capacity() const { return m_slots.size(); }
+      size_t size() const { return m_tail.load() - m_head.load(); }
+      bool empty() const { return size() == 0; }
+
+      /** Slot to fill next, 0 if the ring is full (producer) */
+      T * back() {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load() == m_slots.size()) return 0;
+        return &m_slots[tail & (m_slots.size() - 1)];
+      }
+      void push() {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1);
+        if (m_wait_data.load()) wake();
+      }
+      /** Oldest filled slot, 0 if the ring is empty (consumer) */
+      T * front() {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load()) return 0;
+        return &m_slots[head & (m_slots.size() - 1)];
+      }
+      void pop() {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1);
+        if (m_wait_space.load()) wake();
+      }
+
+      /** Like back()/front(), but sleep up to timeout_ms for a slot; 0 on timeout or after wake() */
+      T * wait_back(unsigned timeout_ms) { return wait(&SPSCRing::back, m_wait_space, timeout_ms); }
+      T * wait_front(unsigned timeout_ms) { return wait(&SPSCRing::front, m_wait_data, timeout_ms); }
+
+      /** Wakes a sleeping thread, e.g. to make it check a stop flag */
+      void wake() {
+        { std::lock_guard<std::mutex> lock(m_mutex); }
+        m_cv.notify_all();
+      }
+    private:
+      T * wait(T * (SPSCRing::*get)(), std::atomic<bool> & waiting, unsigned timeout_ms) {
+        T * slot = (this->*get)();
+        if (slot) return slot;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        // the other thread checks the flag after publishing, so either it wakes us or we see its slot
+        waiting.store(true);
+        slot = (this->*get)();
+        if (!slot) {
+          m_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms));
+          slot = (this->*get)();
+        }
+        waiting.store(false);
+        return slot;
+      }
+
+      std::vector<T> m_slots;
+      std::atomic<size_t> m_head, m_tail;
+      std::atomic<bool> m_wait_data, m_wait_space;
+      std::mutex m_mutex;
+      std::condition_variable m_cv;
+  };
+
+}
+
+#endif // EUDAQ_INCLUDED_SPSCRing
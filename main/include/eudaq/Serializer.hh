@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
+#include <type_traits>
 #include "eudaq/Serializable.hh"
 
 #include "eudaq/Time.hh"
@@ -16,6 +18,17 @@ namespace eudaq {
     const char * what() const throw() { return "InterruptedException"; }
   };
 
+  /** Types whose memory layout on a little-endian host is identical to the
+   *  serialized format, so vectors of them can be copied in one go.
+   */
+  template <typename T>
+    struct IsBulkSerializable : std::integral_constant<bool, std::is_arithmetic<T>::value && !std::is_same<T, bool>::value> {};
+
+  inline bool HostIsLittleEndian() {
+    const uint16_t one = 1;
+    return *reinterpret_cast<const unsigned char *>(&one) == 1;
+  }
+
   class DLLEXPORT Serializer {
     public:
       virtual void Flush() {}
@@ -39,6 +52,10 @@ namespace eudaq {
 
       virtual ~Serializer() {}
     private:
+      template <typename T>
+        void write_elements(const std::vector<T> & t, std::true_type);
+      template <typename T>
+        void write_elements(const std::vector<T> & t, std::false_type);
       template <typename T>
         friend struct WriteHelper;
       virtual void Serialize(const unsigned char *, size_t) = 0;
@@ -130,7 +147,21 @@ namespace eudaq {
     inline void Serializer::write(const std::vector<T> & t) {
       unsigned len = t.size();
       write(len);
-      for (size_t i = 0; i < len; ++i) {
+      write_elements(t, IsBulkSerializable<T>());
+    }
+
+  template <typename T>
+    inline void Serializer::write_elements(const std::vector<T> & t, std::true_type) {
+      if (!HostIsLittleEndian()) {
+        write_elements(t, std::false_type());
+      } else if (!t.empty()) {
+        Serialize(reinterpret_cast<const unsigned char *>(&t[0]), t.size() * sizeof (T));
+      }
+    }
+
+  template <typename T>
+    inline void Serializer::write_elements(const std::vector<T> & t, std::false_type) {
+      for (size_t i = 0; i < t.size(); ++i) {
         write(t[i]);
       }
     }
@@ -190,10 +221,19 @@ namespace eudaq {
 
       void read( unsigned char *dst, size_t size ) { Deserialize( dst, size ); }
 
+      /** Skips the next len bytes and returns a pointer to them if the backend keeps
+       *  the whole stream in memory (source then keeps that memory alive), 0 otherwise.
+       */
+      virtual const unsigned char * View(size_t /*len*/, std::shared_ptr<const void> & /*source*/) { return 0; }
+
       virtual ~Deserializer() {}
     protected:
       bool m_interrupting;
     private:
+      template <typename T>
+        void read_elements(std::vector<T> & t, size_t len, std::true_type);
+      template <typename T>
+        void read_elements(std::vector<T> & t, size_t len, std::false_type);
       template <typename T>
         friend struct ReadHelper;
       virtual void Deserialize(unsigned char *, size_t) = 0;
@@ -285,7 +325,24 @@ namespace eudaq {
     inline void Deserializer::read(std::vector<T> & t) {
       unsigned len = 0;
       read(len);
-      t.reserve(len);
+      read_elements(t, len, IsBulkSerializable<T>());
+    }
+
+  template <typename T>
+    inline void Deserializer::read_elements(std::vector<T> & t, size_t len, std::true_type) {
+      if (!HostIsLittleEndian()) {
+        read_elements(t, len, std::false_type());
+      } else if (len) {
+        // elements are appended, as in the element-wise version
+        size_t offset = t.size();
+        t.resize(offset + len);
+        Deserialize(reinterpret_cast<unsigned char *>(&t[offset]), len * sizeof (T));
+      }
+    }
+
+  template <typename T>
+    inline void Deserializer::read_elements(std::vector<T> & t, size_t len, std::false_type) {
+      t.reserve(t.size() + len);
       for (size_t i = 0; i < len; ++i) {
         t.push_back(read<T>());
       }
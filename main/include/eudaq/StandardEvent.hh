@@ -2,10 +2,12 @@
 #define EUDAQ_INCLUDED_StandardEvent
 
 #include "eudaq/Event.hh"
+#include "eudaq/WaveformKernels.hh"
 #include <vector>
 #include <string>
 #include <algorithm>
 #include <cmath>
+#include <memory>
 class TF1;
 
 namespace eudaq {
@@ -21,15 +23,22 @@ public:
 	template <typename T>
 	void SetWaveform(T (*data)) {//todo: FIx issue with template
 		m_samples.clear();
-		for (size_t i = 0; i < m_n_samples;i++)
-			m_samples.push_back(data[i]);
+		m_samples.assign(data, data + m_n_samples);
 	} //todo: FIx issue with template
+	/** Take over already converted samples without copying them */
+	void SetWaveform(std::vector<float> && samples) {
+		m_samples = std::move(samples);
+		m_n_samples = uint16_t(m_samples.size());
+	}
 //	void SetWaveform(float* data);
 	std::vector<float>* GetData() const{return &m_samples;};
 	void SetTriggerCell(uint16_t trigger_cell) {m_trigger_cell=trigger_cell;}
 	uint16_t GetTriggerCell() const{return m_trigger_cell;}
 	void SetPolarities(signed char polarity, signed char pulser_polarity) { m_polarity = polarity; m_pulser_polarity = pulser_polarity; }
-	void SetTimes(std::vector<float> * tcal) { m_times = getCalibratedTimes(tcal); }
+	void SetTimes(std::vector<float> * tcal) { m_times = std::make_shared<const std::vector<float> >(getCalibratedTimes(tcal)); }
+	/** Share a precomputed time axis, e.g. from TimeCalibration::GetTimes */
+	void SetTimes(const std::shared_ptr<const std::vector<float> > & times) { m_times = times; }
+	const std::vector<float> & GetTimes() const;
 	unsigned ID() const;
 	void Print(std::ostream &) const;
 	std::string GetType() const {return m_type;}
@@ -42,17 +51,16 @@ public:
 	uint64_t GetTimeStamp() const {return m_timestamp;}
 //	std::string GetName() const {return m_sensor+(std::string)"_"+m_type+(std::string)to_string(m_id);}
     float getMinInRange(int min, int max) const{
-        return (*std::min_element(&m_samples.at(min), &m_samples.at(max)));
+        return waveform::Min(&m_samples.at(min), size_t(&m_samples.at(max) - &m_samples.at(min)));
     };
     float getMaxInRange(int min, int max) const{
-        return (*std::max_element(&m_samples.at(min), &m_samples.at(max)));
+        return waveform::Max(&m_samples.at(min), size_t(&m_samples.at(max) - &m_samples.at(min)));
     };
     float getAbsMaxInRange(int min,int max) const{
         return abs(m_samples.at(getIndexAbsMax(min,max)));
     }
 	uint16_t getIndexMin(int min, int max) const{
-        float* min_el = std::min_element(&m_samples.at(min), &m_samples.at(max));
-        return uint16_t(std::distance(&m_samples.at(0),min_el));//-m_samples.begin();
+        return uint16_t(min + waveform::ArgMin(&m_samples.at(min), size_t(&m_samples.at(max) - &m_samples.at(min))));
     };
     int getIndexAbsMax(int min,int max) const{
         float mi = getIndexMin(min,max);
@@ -60,15 +68,14 @@ public:
         return abs(m_samples.at(mi))>abs(m_samples.at(ma))?mi:ma;
     }
 	uint16_t getIndexMax(int min, int max) const{
-        float* max_el = std::max_element(&m_samples.at(min), &m_samples.at(max));
-        return uint16_t(std::distance(&m_samples.at(0),max_el));//-m_samples.begin();
+        return uint16_t(min + waveform::ArgMax(&m_samples.at(min), size_t(&m_samples.at(max) - &m_samples.at(min))));
     };
 
 	uint16_t getIndex(uint16_t min, uint16_t max, signed char pol) const {
 		return (pol * 1 > 0) ? getIndexMax(min, max) : getIndexMin(min, max);
 	}
 
-	float getCFT(uint16_t min, uint16_t max, uint8_t delay=4, float factor=.5) const;  // return the constant fraction time of the signal in [min, max]
+	float getCFT(uint16_t min, uint16_t max, uint8_t delay=4, float factor=.5) const;  // return the constant fraction time of the signal in [min, max], NaN if that has less than two samples
 
     std::pair<int,float> getAbsMaxAndValue(int min, int max) const{
         int index = getIndexAbsMax(min,max);
@@ -76,7 +83,8 @@ public:
     }
     float getMedian(uint32_t min, uint32_t max) const;
 
-		std::vector<uint16_t> * getAllPeaksAbove(uint16_t min, uint16_t max, float threshold) const;
+		/** Fills peaks (cleared first) with the positions of all peaks above threshold in [min, max] */
+		void getAllPeaksAbove(uint16_t min, uint16_t max, float threshold, std::vector<uint16_t> & peaks) const;
 		std::pair<uint16_t, float> getMaxPeak() const;
     float getSpreadInRange(int min, int max) const{return (getMaxInRange(min,max)-getMinInRange(min,max));};
     float getPeakToPeak(int min, int max) const{return getSpreadInRange(min,max);}
@@ -91,9 +99,13 @@ public:
     float getFallTime(uint16_t bin_low, uint16_t bin_high, float noise) const;
     float getWFStartTime(uint16_t bin_low, uint16_t bin_high, float noise, float max_value) const;
     std::pair<float, float> fitMaximum(uint16_t bin_low, uint16_t bin_high) const;
+    /** closed-form replacements of the Minuit fits above: least squares line through the same leading edge points
+     *  and parabolic (gauss = true: parabola through the log of the samples) interpolation of the maximum */
+    float getWFStartTimeLinear(uint16_t bin_low, uint16_t bin_high, float noise, float max_value) const;
+    std::pair<float, float> interpolateMaximum(uint16_t bin_low, uint16_t bin_high, bool gauss = false) const;
     float interpolateTime(uint16_t ibin, float value) const;
     float interpolateVoltage(uint16_t ibin, float time) const;
-    float getBinWidth(uint16_t ibin) const { return m_times.at(ibin) - m_times.at(uint16_t(ibin - 1)); }
+    float getBinWidth(uint16_t ibin) const { return GetTimes().at(ibin) - GetTimes().at(uint16_t(ibin - 1)); }
 
 private:
 	uint64_t m_timestamp;
@@ -105,7 +117,7 @@ private:
 	uint16_t m_trigger_cell;
 	signed char m_polarity;
 	signed char m_pulser_polarity;
-	std::vector<float> m_times;
+	std::shared_ptr<const std::vector<float> > m_times;
 
 };
 
@@ -118,14 +130,26 @@ public:
 
 		FLAG_WITHPIVOT = 0x10000, // Include before/after pivot boolean per pixel
 		FLAG_WITHSUBMAT = 0x20000, // Include Submatrix ID per pixel
-		FLAG_DIFFCOORDS = 0x40000 // Each frame can have different coordinates (in ZS mode)
+		FLAG_DIFFCOORDS = 0x40000, // Each frame can have different coordinates (in ZS mode)
+		FLAG_COMPACT = 0x80000 // Single frame stored as uint16 coordinates and float values (in memory only)
 	};
 	typedef double pixel_t;
 	typedef double coord_t;
+	/** Struct of arrays of the hits of a plane (before polarity), 8 instead of 24 bytes per pixel */
+	struct CompactPixels {
+		std::vector<uint16_t> x, y;
+		std::vector<float> pix;
+		size_t size() const { return pix.size(); }
+		void resize(size_t n) { x.resize(n); y.resize(n); pix.resize(n); }
+	};
 	StandardPlane(unsigned id, const std::string & type,
 			const std::string & sensor = "");
 	StandardPlane(Deserializer &);
 	StandardPlane();
+	/** The cached results point into the plane itself, so copies and moves start without them */
+	StandardPlane(const StandardPlane &);
+	StandardPlane(StandardPlane &&);
+	StandardPlane & operator=(StandardPlane);
 	void Serialize(Serializer &) const;
 	void SetSizeRaw(unsigned w, unsigned h,
 			unsigned frames = 1, int flags = 0);
@@ -167,6 +191,12 @@ public:
 	// defined for short, int, double
 	template <typename T>
 	std::vector<T> GetPixels() const{
+		if (IsCompact()) {
+			std::vector<T> result(m_compact.size());
+			for (size_t i = 0; i < result.size(); ++i)
+				result[i] = static_cast<T>(m_compact.pix[i] * Polarity());
+			return result;
+		}
 		SetupResult();
 		std::vector<T> result(m_result_pix->size());
 		for (size_t i = 0; i < result.size(); ++i) {
@@ -180,6 +210,9 @@ public:
 	const std::vector<coord_t> & YVector() const;
 	const std::vector<pixel_t> & PixVector(unsigned frame) const;
 	const std::vector<pixel_t> & PixVector() const;
+	/** The resulting hits as in GetX/GetY/GetPixel(index); no copy for compact planes, built once for the others */
+	const CompactPixels & Compact() const;
+	bool IsCompact() const { return GetFlags(FLAG_COMPACT) != 0; }
 
 	void SetXSize(unsigned x);
 	void SetYSize(unsigned y);
@@ -212,6 +245,7 @@ public:
 private:
 	const std::vector<pixel_t> & GetFrame(const std::vector<std::vector<pixel_t> > & v, unsigned f) const;
 	void SetupResult() const;
+	void ResetResult();
 	std::string m_type, m_sensor;
 	unsigned m_id, m_tluevent;
 	unsigned m_xsize, m_ysize;
@@ -228,6 +262,9 @@ private:
 
 	mutable std::vector<pixel_t> m_temp_pix;
 	mutable std::vector<coord_t> m_temp_x, m_temp_y;
+	/** the storage of compact planes, a cache of the result for the others */
+	mutable CompactPixels m_compact;
+	mutable bool m_compact_done;
 };
 
 
@@ -311,6 +348,7 @@ public:
 
 
 	StandardPlane & AddPlane(const StandardPlane &);
+	StandardPlane & AddPlane(StandardPlane &&);
 	size_t NumPlanes() const;
 	const StandardPlane & GetPlane(size_t i) const;
 	StandardPlane & GetPlane(size_t i);
@@ -318,11 +356,13 @@ public:
 	virtual void Print(std::ostream &) const;
 
 	StandardWaveform & AddWaveform(const StandardWaveform &);
+	StandardWaveform & AddWaveform(StandardWaveform &&);
+	void ReserveWaveforms(size_t n) { m_waveforms.reserve(n); }
 	uint16_t NumWaveforms() const { return uint16_t(m_waveforms.size()); }
 	uint16_t GetNWaveforms() const {return NumWaveforms();}
 	const StandardWaveform & GetWaveform(size_t i) const;
 	StandardWaveform & GetWaveform(size_t i);
-	bool hasTUEvent();
+	bool hasTUEvent() const;
 
 
 private:
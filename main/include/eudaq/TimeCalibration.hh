@@ -0,0 +1,45 @@
+#ifndef EUDAQ_INCLUDED_TimeCalibration
+#define EUDAQ_INCLUDED_TimeCalibration
+
+#include <vector>
+#include <memory>
+#include "eudaq/Platform.hh"
+
+#if ((defined WIN32) && (defined __CINT__))
+typedef unsigned short uint16_t
+#else
+#include <cstdint>
+#endif
+
+namespace eudaq {
+
+  /** Time calibration of one DRS4 channel, precomputed once per run.
+   *  Holds the cumulative bin widths over two turns of the ring buffer, so time differences
+   *  are two lookups, and optionally the calibrated time axis for every trigger cell, which
+   *  the waveforms share instead of computing their own copy.
+   */
+  class DLLEXPORT TimeCalibration {
+    public:
+      typedef std::shared_ptr<const std::vector<float> > axis_t;
+      TimeCalibration() : m_n_samples(0) {}
+      /** tcal holds the bin widths of the n_samples cells, build_axes also builds the per trigger cell time axes */
+      TimeCalibration(const std::vector<float> & tcal, uint16_t n_samples, bool build_axes = true);
+      uint16_t GetNSamples() const { return m_n_samples; }
+      bool HasAxes() const { return !m_axes.empty(); }
+      /** Same values as StandardWaveform::getCalibratedTimes for this trigger cell */
+      const axis_t & GetTimes(uint16_t trigger_cell) const { return m_axes.at(trigger_cell); }
+      float GetTriggerTime(uint16_t bin, uint16_t trigger_cell) const {
+        return m_full_time.at(bin + trigger_cell) - m_full_time.at(trigger_cell);
+      }
+      float GetTimeDifference(uint16_t bin_low, uint16_t bin_up, uint16_t trigger_cell) const {
+        return m_full_time.at(bin_up + trigger_cell) - m_full_time.at(uint16_t(bin_low + trigger_cell));
+      }
+    private:
+      uint16_t m_n_samples;
+      std::vector<float> m_full_time;
+      std::vector<axis_t> m_axes;
+  };
+
+}
+
+#endif // EUDAQ_INCLUDED_TimeCalibration
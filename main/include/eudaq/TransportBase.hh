@@ -13,6 +13,7 @@
 #include <iosfwd>
 #include <cstring>
 #include <iostream>
+#include <memory>
 
 namespace eudaq {
 
@@ -25,6 +26,8 @@ namespace eudaq {
       virtual ~ConnectionInfo() {}
       virtual void Print(std::ostream &) const;
       virtual bool Matches(const ConnectionInfo & other) const;
+      /** Hash for lookup tables, connections that match must have the same hash */
+      virtual size_t Hash() const { return 0; }
       bool IsEnabled() const { return m_state >= 0; }
       int GetState() const { return m_state; }
       void SetState(int state) { m_state = state; }
@@ -51,15 +54,34 @@ namespace eudaq {
     return os;
   }
 
+  /** A received packet that is not copied out of the receive buffer.
+   * owner keeps the buffer alive for as long as the view (or anything made from it) exists.
+   */
+  struct PacketView {
+    PacketView() : data(0), size(0) {}
+    PacketView(const std::shared_ptr<const void> & owner, const unsigned char * data, size_t size)
+      : data(data), size(size), owner(owner) {}
+    bool empty() const { return size == 0; }
+    const unsigned char * begin() const { return data; }
+    const unsigned char * end() const { return data + size; }
+    std::string str() const { return std::string(reinterpret_cast<const char *>(data), size); }
+    const unsigned char * data;
+    size_t size;
+    std::shared_ptr<const void> owner;
+  };
+
   /** Represents an event such as a connection, or receipt of data on a Transport.
    */
   struct TransportEvent {
     enum EventType { CONNECT, DISCONNECT, RECEIVE };
     TransportEvent(EventType et, ConnectionInfo & i, const std::string & p = "")
       : etype(et), id(i), packet(p) {}
+    TransportEvent(EventType et, ConnectionInfo & i, const PacketView & v)
+      : etype(et), id(i), view(v) {}
     EventType etype;    ///< The type of event
     ConnectionInfo & id;    ///< The id of the connection
     std::string packet; ///< The packet of data in case of a RECEIVE event
+    PacketView view;    ///< The packet instead of packet, if the server hands out views (see TransportServer::SetPacketViews)
   };
 
   /** Represents a callback function for the Transport system.
@@ -11,6 +11,10 @@ namespace eudaq {
       //virtual void SendPacket(const std::string & packet) = 0;
       //virtual bool ReceivePacket(std::string * packet, int timeout = -1) = 0;
 
+      /** Send small packets right away instead of letting the transport coalesce them
+       *  (for senders that do their own batching), if the transport supports it */
+      virtual void SetNoDelay(bool /*nodelay*/) {}
+
       virtual ~TransportClient();
   };
 
@@ -13,8 +13,13 @@ namespace eudaq {
       virtual std::string ConnectionString() const = 0;
       size_t NumConnections() const { return m_conn.size(); }
       const ConnectionInfo & GetConnection(size_t i) const { return *m_conn[i]; }
+      /** Data from identified connections (state > 0) is then received as TransportEvent::view
+       *  only, without a copy into TransportEvent::packet. Not every transport supports it. */
+      void SetPacketViews(bool views) { m_packetviews = views; }
     protected:
+      TransportServer() : m_packetviews(false) {}
       std::vector<std::shared_ptr<ConnectionInfo> > m_conn;
+      bool m_packetviews;
   };
 
 }
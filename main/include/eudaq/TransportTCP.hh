@@ -17,27 +17,51 @@ typedef int SOCKET;
 #include <vector>
 #include <string>
 #include <map>
+#include <memory>
 
 namespace eudaq {
 
-  class ConnectionInfoTCP : public ConnectionInfo {
+  /** Receive buffer of a TCP connection.
+   * Data is recv()'d straight into a pooled chunk and the length-prefixed packets are framed in place,
+   * so they can be handed out as views sharing ownership of the chunk. A chunk grows to hold a whole
+   * packet; the unread rest is moved to the front (or to a fresh chunk while views are still alive).
+   */
+  class TCPReceiveBuffer {
     public:
-      ConnectionInfoTCP(SOCKET fd, const std::string & host = "") : m_fd(fd), m_host(host), m_len(0), m_buf("") {}
+      TCPReceiveBuffer() : m_begin(0), m_end(0) {}
+      /** Returns where to recv() to and in avail how much space there is */
+      unsigned char * reserve(size_t & avail);
+      void commit(size_t length) { m_end += length; }
       void append(size_t length, const char * data);
       bool havepacket() const;
-      std::string getpacket();
+      PacketView getview();
+      void clear() { m_chunk.reset(); m_begin = m_end = 0; }
+    private:
+      size_t packetlength() const;
+      std::shared_ptr<std::vector<unsigned char> > m_chunk;
+      size_t m_begin, m_end;
+  };
+
+  class ConnectionInfoTCP : public ConnectionInfo {
+    public:
+      ConnectionInfoTCP(SOCKET fd, const std::string & host = "") : m_fd(fd), m_host(host) {}
+      unsigned char * reserve(size_t & avail) { return m_buf.reserve(avail); }
+      void commit(size_t length) { m_buf.commit(length); }
+      void append(size_t length, const char * data) { m_buf.append(length, data); }
+      bool havepacket() const { return m_buf.havepacket(); }
+      std::string getpacket() { return m_buf.getview().str(); }
+      PacketView getview() { return m_buf.getview(); }
       SOCKET GetFd() const { return m_fd; }
-      void Disable() { m_state = -1; m_len = 0; m_buf = ""; }
+      void Disable() { m_state = -1; m_buf.clear(); }
       virtual bool Matches(const ConnectionInfo & other) const;
+      virtual size_t Hash() const { return static_cast<size_t>(m_fd); }
       virtual void Print(std::ostream &) const;
       virtual std::string GetRemote() const { return m_host; }
       virtual ConnectionInfo * Clone() const { return new ConnectionInfoTCP(*this); }
     private:
-      void update_length(bool = false);
       SOCKET m_fd;
       std::string m_host;
-      size_t m_len;
-      std::string m_buf;
+      TCPReceiveBuffer m_buf;
   };
 
   class TCPServer : public TransportServer {
@@ -54,10 +78,14 @@ namespace eudaq {
       virtual std::string ConnectionString() const;
       static const std::string name;
     private:
+      void Accept();
+      bool Receive(SOCKET fd);
+      void Unwatch(SOCKET fd);
       int m_port;
       SOCKET m_srvsock;
       SOCKET m_maxfd;
       fd_set m_fdset;
+      int m_epfd; ///< epoll instance on Linux, select() is used elsewhere
 
       ConnectionInfoTCP & GetInfo(SOCKET fd) const;
       //typedef std::map<int, TCPConnection> map_t;
@@ -73,6 +101,7 @@ namespace eudaq {
           const ConnectionInfo & id = ConnectionInfo::ALL,
           bool = false);
       virtual void ProcessEvents(int timeout = -1);
+      virtual void SetNoDelay(bool nodelay);
     private:
       void OpenConnection();
       std::string m_server;
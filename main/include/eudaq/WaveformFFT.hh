@@ -0,0 +1,51 @@
+#ifndef EUDAQ_INCLUDED_WaveformFFT
+#define EUDAQ_INCLUDED_WaveformFFT
+
+#include "eudaq/Platform.hh"
+#include <vector>
+#include <string>
+#include <cstddef>
+
+class TVirtualFFT;
+struct fftwf_plan_s;
+
+namespace eudaq {
+
+  /** Real-to-complex transforms of several waveforms of the same length at once.
+   *  With FFTW the whole batch is one in-place float "many" plan, created once per size and shared by all instances;
+   *  without it every channel goes through a TVirtualFFT. An instance must only be used by one thread.
+   */
+  class DLLEXPORT WaveformFFT {
+    public:
+      WaveformFFT();
+      ~WaveformFFT();
+      /** Sets up n_channels transforms of n samples each, cheap if the sizes did not change */
+      void Resize(size_t n_channels, size_t n);
+      size_t NChannels() const { return m_n_channels; }
+      size_t NSamples() const { return m_n; }
+      size_t NBins() const { return m_n / 2 + 1; }
+      /** Copies the samples of channel i, zero padded or cut to NSamples() */
+      void SetInput(size_t i, const float * data, size_t n);
+      /** Transforms all channels and computes the magnitudes */
+      void Transform();
+      /** |X_k| for k in [0, NBins()) of channel i */
+      const float * Magnitudes(size_t i) const { return &m_mag[i * NBins()]; }
+
+      /** FFTW wisdom is read from this file now and written back whenever a new plan was made, "" = none */
+      static void SetWisdomFile(const std::string & path);
+    private:
+      WaveformFFT(const WaveformFFT &);
+      WaveformFFT & operator=(const WaveformFFT &);
+      void Free();
+      size_t m_n_channels, m_n;
+      size_t m_dist;             ///< floats per row of the in-place buffer
+      float * m_buffer;
+      fftwf_plan_s * m_plan;
+      TVirtualFFT * m_root_fft;
+      std::vector<double> m_in, m_re, m_im;
+      std::vector<float> m_mag;
+  };
+
+}
+
+#endif // EUDAQ_INCLUDED_WaveformFFT
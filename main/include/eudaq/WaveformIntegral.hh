@@ -21,6 +21,8 @@ class WaveformIntegral:public TObject{
         void SetPeakPosition(int peak_position,int n_samples);
         uint16_t GetIntegralStart() const {return integral_start;}
         uint16_t GetIntegralStop() const {return integral_stop;}
+        int GetDownRange() const {return down_range;}
+        int GetUpRange() const {return up_range;}
         void SetIntegral(float integral);
         void SetTimeIntegral(float integral) { time_integral = integral; }
         float GetIntegral(){ return !calculated ? std::numeric_limits<float>::quiet_NaN() : integral; }
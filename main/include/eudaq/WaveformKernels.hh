@@ -0,0 +1,58 @@
+#ifndef EUDAQ_INCLUDED_WaveformKernels
+#define EUDAQ_INCLUDED_WaveformKernels
+
+#include "eudaq/Platform.hh"
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace eudaq {
+
+  /** Allocation-free reductions over waveform samples, used by StandardWaveform.
+   *  Buffers that a kernel needs are passed in by the caller and only grow.
+   */
+  namespace waveform {
+
+    /** Smallest/largest value in data[0, n), n > 0 */
+    DLLEXPORT float Min(const float * data, size_t n);
+    DLLEXPORT float Max(const float * data, size_t n);
+    /** Index of the first smallest/largest value, like std::min_element/std::max_element */
+    DLLEXPORT size_t ArgMin(const float * data, size_t n);
+    DLLEXPORT size_t ArgMax(const float * data, size_t n);
+    /** Sum of the values (abs = true: of their absolute values), accumulated in four interleaved partial sums */
+    DLLEXPORT float Sum(const float * data, size_t n, bool abs = false);
+    /** Median, the mean of the two central values for even n, as TMath::Median */
+    DLLEXPORT float Median(const float * data, size_t n, std::vector<float> & scratch);
+    /** out[k] = |c_k| for n complex values stored as interleaved (re, im) pairs */
+    DLLEXPORT void Magnitudes(const float * complex, size_t n, float * out);
+
+    /** Running sums over one waveform, built once per event, which answer every integral over it
+     *  with two lookups plus the interpolation at the edges. Keeps pointers to the samples and times.
+     */
+    class DLLEXPORT PrefixSums {
+      public:
+        PrefixSums() : m_data(0), m_times(0), m_n(0) {}
+        /** times: calibrated time of each sample, only needed for TimeIntegral() */
+        void Build(const float * data, size_t n, const float * times = 0);
+        size_t Size() const { return m_n; }
+        /** Sum of the samples [first, last) */
+        double Sum(size_t first, size_t last) const { return m_sum[last] - m_sum[first]; }
+        /** Same as StandardWaveform::getIntegral(min, max) */
+        float Integral(uint16_t min, uint16_t max) const;
+        /** Same as StandardWaveform::getIntegral(low_bin, high_bin, peak_pos, sspeed) */
+        float TimeIntegral(uint16_t low_bin, uint16_t high_bin, uint16_t peak_pos, float sspeed) const;
+      private:
+        float Voltage(size_t ibin, float time) const;
+        const float * m_data;
+        const float * m_times;
+        size_t m_n;
+        std::vector<float> m_terms;
+        std::vector<double> m_sum;   ///< m_sum[i]: samples [0, i)
+        std::vector<double> m_trap;  ///< m_trap[i]: trapezoids of the bins [0, i), each weighted with the width of the bin before
+    };
+
+  }
+
+}
+
+#endif // EUDAQ_INCLUDED_WaveformKernels
@@ -26,6 +26,8 @@ namespace eudaq {
       return m_converter.GetStandardSubEvent(out,in);
     }
     virtual std::string GetStats() { return m_converter.GetStats(); }
+    virtual DataConverterPlugin * Clone() const { return new CMSPixelConverterPlugin(*this); }
+
     virtual void set_conversion(bool val){m_converter.set_conversion(val);}
     virtual bool get_conversion(){return m_converter.get_conversion();}
 #if USE_LCIO && USE_EUTELESCOPE
@@ -38,6 +38,8 @@ namespace eudaq {
     }
 #endif
 
+    virtual DataConverterPlugin * Clone() const { return new CMSPixelDIGConverterPlugin(*this); }
+
     virtual void set_conversion(bool val){m_converter.set_conversion(val);}
     virtual bool get_conversion(){return m_converter.get_conversion();}
   private:
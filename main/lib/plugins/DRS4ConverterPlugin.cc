@@ -1,4 +1,8 @@
 #include "eudaq/DataConverterPlugin.hh"
+#include <cstring>
+#if defined(__AVX2__) || defined(__SSE2__)
+#  include <immintrin.h>
+#endif
 
 // All LCIO-specific parts are put in conditional compilation blocks
 // so that the other parts may still be used if LCIO is not available.
@@ -17,6 +21,36 @@ namespace eudaq {
 // Modify this to match your actual event type (from the Producer)
 static const char* EVENT_TYPE = "DRS4";
 
+/** Convert raw DRS4 ADC counts to mV: mV = adc * 1000 / 65536 + range - 500.
+ *  The product is exact in single precision, so the result equals the old double precision formula. */
+static void ConvertSamples(const unsigned char * raw, float * out, size_t n, float offset) {
+	const float scale = 1000.f / 65536.f;
+	size_t i = 0;
+#if defined(__AVX2__)
+	const __m256 vscale = _mm256_set1_ps(scale), voffset = _mm256_set1_ps(offset);
+	for (; i + 8 <= n; i += 8) {
+		__m128i adc = _mm_loadu_si128((const __m128i *) (raw + 2 * i));
+		__m256 f = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(adc));
+		_mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_mul_ps(f, vscale), voffset));
+	}
+#elif defined(__SSE2__)
+	const __m128 vscale = _mm_set1_ps(scale), voffset = _mm_set1_ps(offset);
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 8 <= n; i += 8) {
+		__m128i adc = _mm_loadu_si128((const __m128i *) (raw + 2 * i));
+		__m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(adc, zero));
+		__m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(adc, zero));
+		_mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(lo, vscale), voffset));
+		_mm_storeu_ps(out + i + 4, _mm_add_ps(_mm_mul_ps(hi, vscale), voffset));
+	}
+#endif
+	for (raw += 2 * i; i < n; i++, raw += 2) {
+		unsigned short adc;
+		std::memcpy(&adc, raw, sizeof(adc));
+		out[i] = adc * scale + offset;
+	}
+}
+
 // Declare a new class that inherits from DataConverterPlugin
 class DRS4ConverterPlugin : public DataConverterPlugin {
 private:
@@ -26,6 +60,7 @@ private:
 	int m_n_channels;
 	unsigned char m_activated_channels;
 	std::map<int, std::string> m_channel_names;
+	std::map<int, std::string> m_sensor_names; ///< "<dut>_<channel>", built once per run
 	std::string m_dut_name;
 	std::map<uint8_t, std::vector<float> > m_tcal;
 public:
@@ -50,9 +85,11 @@ public:
 		for (int ch = 0; ch< m_n_channels;ch++){
 					std::string tag = "CH_"+std::to_string(ch+1);
 					m_channel_names[ch] = bore.GetTag(tag,tag);
+					m_sensor_names[ch] = m_dut_name + "_" + m_channel_names[ch];
 					std::cout<<"    "<<tag<<": "<<m_channel_names[ch]<<std::endl;
 				}
 		// extracting the timing calibration
+		m_tcal.clear();
 		const RawDataEvent & in_bore = dynamic_cast<const RawDataEvent &>(bore);
 		for (uint8_t id = 0; id < in_bore.NumBlocks();){
 			RawDataEvent::data_t data = in_bore.GetBlock(id++);
@@ -72,6 +109,8 @@ public:
 		 return this->m_tcal;
 	 } // end GetTimeCalibration
 
+	virtual DataConverterPlugin * Clone() const { return new DRS4ConverterPlugin(*this); }
+
 	// Here, the data from the RawDataEvent is extracted into a StandardEvent.
 	// The return value indicates whether the conversion was successful.
 	// Again, this is just an example, adapted it for the actual data layout.
@@ -86,45 +125,40 @@ public:
 		// they can be differentiated here
 		// Create a StandardPlane representing one sensor plane
 		uint8_t id = 0;
-		RawDataEvent::data_t data = in_raw.GetBlock(id++);  // Trigger cell
+		RawDataEvent::data_view data = in_raw.GetBlockView(id++);  // Trigger cell
 		auto trigger_cell = static_cast<uint16_t>(*((int*) &data[0]));
-		data = in_raw.GetBlock(id++); // Get Timestamp
+		data = in_raw.GetBlockView(id++); // Get Timestamp
 		uint64_t timestamp = *((uint64_t*) &data[0]);
 //		sev.SetTimestamp(timestamp);
-		float min_waves[m_n_channels];
-		float max_waves[m_n_channels];
+		sev.ReserveWaveforms(sev.NumWaveforms() + (n_blocks - id) / 2);
+		const float offset = float(range) - 500.f;
 
 		for (id = id; id < n_blocks;){  // Get Raw data
-			data = in_raw.GetBlock(id++); // Get Header
+			data = in_raw.GetBlockView(id++); // Get Header
 			char buffer [5];
 			std::memcpy(&buffer,&(data[0]), 4);
 			buffer[4]='\0';
 			int ch = atoi(&buffer[1])-1;
 
 			//Get Waveform
-			data = in_raw.GetBlock(id++);
+			data = in_raw.GetBlockView(id++);
 			size_t wave_size = data.size();
 			int n_samples = int(wave_size / sizeof(unsigned short));
 
-			unsigned short *raw_wave_array = (unsigned short*) &data[0];
-			float wave_array[n_samples];
-			//Conversion of raw data to voltage data
-			for (int i = 0; i < n_samples; i++)
-				wave_array[i] = (raw_wave_array[i] / 65536. + range/1000.0 - 0.5)*1000.;
-//			min_waves[ch] = *std::min_element(wave_array,wave_array+n_samples);
-//			max_waves[ch] = *std::max_element(wave_array,wave_array+n_samples);
+			//Conversion of raw data to voltage data, directly into the storage handed to the waveform
+			std::vector<float> wave_array(n_samples);
+			ConvertSamples(data.data(), wave_array.data(), n_samples, offset);
 			//conversion of time:
 //			 for (j=0,time[chn_index][i]=0 ; j<i ; j++)
 //			               time[chn_index][i] += bin_width[chn_index][(j+eh.trigger_cell) % 1024];
 			//add Waveform to standard event
-			StandardWaveform wf(ch,EVENT_TYPE,m_dut_name+(std::string)"_"+m_channel_names.at(ch));
+			StandardWaveform wf(ch,EVENT_TYPE,m_sensor_names.at(ch));
 			wf.SetChannelName(m_channel_names.at(ch));
 			wf.SetChannelNumber(ch);
-			wf.SetNSamples(n_samples);
-			wf.SetWaveform((float*) wave_array);
+			wf.SetWaveform(std::move(wave_array));
 			wf.SetTimeStamp(timestamp);
 			wf.SetTriggerCell(trigger_cell);
-			sev.AddWaveform(wf);
+			sev.AddWaveform(std::move(wf));
 		}
 		return true;
 	}
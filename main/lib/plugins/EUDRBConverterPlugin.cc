@@ -197,6 +197,8 @@ namespace eudaq {
         FillInfo(e, c);
       }
 
+      virtual DataConverterPlugin * Clone() const { return new EUDRBConverterPlugin(*this); }
+
       virtual unsigned GetTriggerID(Event const & ev) const {
         const RawDataEvent & rawev = dynamic_cast<const RawDataEvent &>(ev);
         if (rawev.NumBlocks() < 1) return (unsigned)-1;
@@ -232,6 +234,8 @@ namespace eudaq {
       FillInfo(e, c);
     }
 
+    virtual DataConverterPlugin * Clone() const { return new LegacyEUDRBConverterPlugin(*this); }
+
     virtual unsigned GetTriggerID(Event const & ev) const {
       const RawDataEvent & rawev = dynamic_cast<const RawDataEvent &>(ev);
       if (rawev.NumBlocks() < 1) return (unsigned)-1;
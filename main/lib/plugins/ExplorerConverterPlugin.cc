@@ -104,6 +104,8 @@ namespace eudaq {
 
     //Get TLU trigger ID from your RawData or better from a different block
     //example: has to be fittet to our needs depending on block managing etc.
+    virtual DataConverterPlugin * Clone() const { return new ExplorerConverterPlugin(*this); }
+
     virtual unsigned GetTriggerID(const Event & ev) const {
       // Make sure the event is of class RawDataEvent
       if (const RawDataEvent * rev = dynamic_cast<const RawDataEvent *> (&ev)) {
@@ -66,6 +66,8 @@ namespace eudaq {
       }
     }
 
+    virtual DataConverterPlugin * Clone() const { return new NIConverterPlugin(*this); }
+
     virtual unsigned GetTriggerID(Event const & ev) const {
       const RawDataEvent & rawev = dynamic_cast<const RawDataEvent &>(ev);
       if (rawev.NumBlocks() < 1 || rawev.GetBlock(0).size() < 8) return (unsigned)-1;
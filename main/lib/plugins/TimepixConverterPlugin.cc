@@ -72,6 +72,8 @@ namespace eudaq {
     // This should return the trigger ID (as provided by the TLU)
     // if it was read out, otherwise it can either return (unsigned)-1,
     // or be left undefined as there is already a default version.
+    virtual DataConverterPlugin * Clone() const { return new TimepixConverterPlugin(*this); }
+
     virtual unsigned GetTriggerID(const Event & /*ev*/) const {
 	
 //	const RawDataEvent * rev = dynamic_cast<const RawDataEvent *> (&ev);
@@ -595,6 +595,8 @@ class USBPixI4ConverterPlugin : public DataConverterPlugin , public USBPixI4Conv
 
 class USBPixFEI4AConverter : USBPixI4ConverterPlugin<0x00007F00, 0x000000FF>
 {
+  public:
+	virtual DataConverterPlugin * Clone() const { return new USBPixFEI4AConverter(*this); }
   private:
  	//The constructor can be private, only one static instance is created
 	USBPixFEI4AConverter():  USBPixI4ConverterPlugin<0x00007F00, 0x000000FF>(USBPIX_FEI4A_NAME) {};
@@ -603,6 +605,8 @@ class USBPixFEI4AConverter : USBPixI4ConverterPlugin<0x00007F00, 0x000000FF>
 
 class USBPixFEI4BConverter : USBPixI4ConverterPlugin<0x00007C00, 0x000003FF>
 {
+  public:
+	virtual DataConverterPlugin * Clone() const { return new USBPixFEI4BConverter(*this); }
   private:
 	USBPixFEI4BConverter():  USBPixI4ConverterPlugin<0x00007C00, 0x000003FF>(USBPIX_FEI4B_NAME){};
 	static USBPixFEI4BConverter m_instance;
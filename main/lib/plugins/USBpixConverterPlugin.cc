@@ -189,6 +189,8 @@ namespace eudaq {
       // This should return the trigger ID (as provided by the TLU)
       // if it was read out, otherwise it can either return (unsigned)-1,
       // or be left undefined as there is already a default version.
+      virtual DataConverterPlugin * Clone() const { return new USBPixConverterPlugin(*this); }
+
       virtual unsigned GetTriggerID(const Event & ev) const {
 
         // Make sure the event is of class RawDataEvent
@@ -16,6 +16,8 @@ class V1730ConverterPlugin:public DataConverterPlugin {
 
 
 public:
+  virtual DataConverterPlugin * Clone() const { return new V1730ConverterPlugin(*this); }
+
   virtual void Initialize(const Event & bore, const Configuration & cnf) {
 	//std::cout<<"V1730 Initialize"<<std::endl;
 	//m_serialno = bore.GetTag("V1730_serial_no", (int)-1);
@@ -81,7 +83,7 @@ public:
 	  wf.SetChannelNumber(ch);
 	  wf.SetNSamples(n_samples);
 	  wf.SetWaveform((float*) wave_array);
-	  sev.AddWaveform(wf);
+	  sev.AddWaveform(std::move(wf));
 	  id++;
 	}//end ch loop
 
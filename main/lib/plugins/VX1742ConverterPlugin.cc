@@ -26,6 +26,8 @@ static const char* EVENT_TYPE = "VX1742";
 class VX1742ConverterPlugin:public DataConverterPlugin {
 
 public:
+  virtual DataConverterPlugin * Clone() const { return new VX1742ConverterPlugin(*this); }
+
   virtual void Initialize(const Event & bore, const Configuration & cnf) {
   	std::cout << "Read VX1742 BORE Event" << std::endl;
   	timestamp = bore.GetTag("timestamp", 0);
@@ -171,7 +173,7 @@ public:
           wf.SetWaveform((float*) wave_array);
 	  		  wf.SetTimeStamp(event_timestamp);
 	  		  wf.SetTriggerCell(start_index_cell);
-	  		  sev.AddWaveform(wf);
+	  		  sev.AddWaveform(std::move(wf));
 	  		  id++;
 		    }//end ch loop
 		  }//end if group mask
@@ -29,4 +29,22 @@ namespace eudaq {
     //std::cout << "Remaining: " << (end()-begin()) << /*" \"" << tmp << "\"" <<*/ std::endl;
   }
 
+  void SharedBufferDeserializer::Deserialize(unsigned char * data, size_t len) {
+    if (!len) return;
+    if (len > m_len - m_offset) {
+      EUDAQ_THROW("Deserialize asked for " + to_string(len) +
+          ", only have " + to_string(m_len - m_offset));
+    }
+    std::copy(m_data + m_offset, m_data + m_offset + len, data);
+    m_offset += len;
+  }
+
+  const unsigned char * SharedBufferDeserializer::View(size_t len, std::shared_ptr<const void> & source) {
+    if (!m_owner || len > m_len - m_offset) return 0;
+    const unsigned char * result = m_data + m_offset;
+    m_offset += len;
+    source = m_owner;
+    return result;
+  }
+
 }
@@ -140,6 +140,7 @@ namespace eudaq {
         OnReset();
       } else if (cmd == "STATUS") {
         OnStatus();
+        AddStatusTags();
       } else if (cmd == "DATA") {
         OnData(param);
       } else if (cmd == "LOG") {
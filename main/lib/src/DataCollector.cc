@@ -1,11 +1,14 @@
 #include "eudaq/DataCollector.hh"
 #include "eudaq/TransportFactory.hh"
 #include "eudaq/BufferSerializer.hh"
+#include "eudaq/DataSender.hh"
 #include "eudaq/DetectorEvent.hh"
 #include "eudaq/Logger.hh"
 #include "eudaq/Utils.hh"
+#include "eudaq/Timer.hh"
 #include <iostream>
 #include <ostream>
+#include <algorithm>
 
 namespace eudaq {
 
@@ -17,12 +20,22 @@ namespace eudaq {
       return 0;
     }
 
+    void * DataCollector_writer_thread(void * arg) {
+      DataCollector * dc = static_cast<DataCollector *>(arg);
+      dc->WriterThread();
+      return 0;
+    }
+
   } // anonymous namespace
 
   DataCollector::DataCollector(const std::string & name, const std::string & runcontrol, const std::string & listenaddress, const std::string & runnumberfile) :
-    CommandReceiver("DataCollector", name, runcontrol, false), m_runnumberfile(runnumberfile), m_done(false), m_listening(true), m_dataserver(TransportFactory::CreateServer(listenaddress)), m_thread(), m_numwaiting(0), m_itlu((size_t) -1), m_runnumber(
-     ReadFromFile(runnumberfile, 0U)), m_eventnumber(0), m_runstart(0) {
+    CommandReceiver("DataCollector", name, runcontrol, false), m_runnumberfile(runnumberfile), m_done(false), m_listening(true), m_dataserver(TransportFactory::CreateServer(listenaddress)), m_thread(), m_numwaiting(0), m_itlu((size_t) -1),
+    m_queue_size(10000), m_max_bytes(size_t(1024) << 20), m_bytes(0), m_received_bytes(0), m_timeout(0), m_max_mismatch(-1), m_n_incomplete(0), m_runnumber(
+     ReadFromFile(runnumberfile, 0U)), m_eventnumber(0), m_runstart(0),
+    m_async(false), m_writer_done(false), m_overflow(false), m_n_queued(0), m_queue_high(1000), m_queue_low(500), m_fallback_started(false),
+    m_queue_peak(0), m_n_blocked(0), m_n_overflows(0), m_n_fallback(0), m_blocked_time(0) {
       m_dataserver->SetCallback(TransportCallback(this, &DataCollector::DataHandler));
+      m_dataserver->SetPacketViews(true);
       EUDAQ_DEBUG("Instantiated datacollector with name: " + name);
       m_thread=std::unique_ptr<std::thread>(new std::thread(DataCollector_thread,this));
       EUDAQ_DEBUG("Listen address=" + to_string(m_dataserver->ConnectionString()));
@@ -32,6 +45,7 @@ namespace eudaq {
   DataCollector::~DataCollector() {
     m_done = true;
     m_thread->join();
+    StopWriter();
     delete m_dataserver;
   }
 
@@ -46,9 +60,17 @@ namespace eudaq {
 
   void DataCollector::OnConnect(const ConnectionInfo & id) {
     EUDAQ_INFO("Connection from " + to_string(id));
+    std::lock_guard<std::mutex> lock(m_buffer_mutex);
     Info info;
     info.id = std::shared_ptr<ConnectionInfo>(id.Clone());
-    m_buffer.push_back(info);
+    info.name = id.GetName().empty() ? id.GetType() : id.GetName();
+    info.events.reset(m_queue_size);
+    info.closed = false;
+    info.n_received = info.n_missing = 0;
+    info.peak = 0;
+    info.last = 0;
+    m_buffer.push_back(std::move(info));
+    m_slots[id.Hash()] = m_buffer.size() - 1;
     if (id.GetType() == "Producer" && id.GetName() == "TU") {
       m_itlu = m_buffer.size() - 1;
     }
@@ -56,20 +78,54 @@ namespace eudaq {
 
   void DataCollector::OnDisconnect(const ConnectionInfo & id) {
     EUDAQ_INFO("Disconnected: " + to_string(id));
-    size_t i = GetInfo(id);
-    if (i == m_itlu) {
-      m_itlu = (size_t) -1;
-    } else if (i < m_itlu) {
-      --m_itlu;
+    {
+      std::lock_guard<std::mutex> lock(m_buffer_mutex);
+      size_t i = FindInfo(id);
+      if (i == (size_t) -1)
+        return;
+      // the slot stays until the events it still holds are built
+      m_buffer[i].closed = true;
+      std::unordered_map<size_t, size_t>::iterator it = m_slots.find(id.Hash());
+      if (it != m_slots.end() && it->second == i)
+        m_slots.erase(it);
+      BuildEvents();
     }
-    m_buffer.erase(m_buffer.begin() + i);
+    WriteBuilt();
     // if (during run) THROW
   }
 
   void DataCollector::OnConfigure(const Configuration & param) {
-    m_config = param;
+    // finish writing the queued events with the old writer before replacing it
+    StopWriter();
+    {
+      std::lock_guard<std::mutex> lock(m_buffer_mutex);
+      m_config = param;
+      m_queue_size = std::max(m_config.Get("BuilderQueueSize", 10000), 1);
+      m_max_bytes = size_t(std::max(m_config.Get("BuilderMaxMB", 1024), 0)) << 20;
+      m_timeout = std::max(m_config.Get("BuilderTimeout", 0), 0) / 1e3;
+      m_max_mismatch = m_config.Get("BuilderMaxMismatch", -1);
+    }
     m_writer =  std::shared_ptr<eudaq::FileWriter>(FileWriterFactory::Create(m_config.Get("FileType", ""), &m_config) );
     m_writer->SetFilePattern(m_config.Get("FilePattern", ""));
+
+    m_async = m_config.Get("AsyncWriter", 0) != 0;
+    m_queue_high = std::max(m_config.Get("WriterQueueHigh", 1000), 1);
+    m_queue_low = std::min(size_t(std::max(m_config.Get("WriterQueueLow", int(m_queue_high / 2)), 0)), m_queue_high - 1);
+    m_fallback_type = m_config.Get("WriterFallbackType", "");
+    m_fallback.reset();
+    if (m_async && !m_fallback_type.empty()) {
+      if (m_fallback_type == m_config.Get("FileType", "")) {
+        EUDAQ_WARN("WriterFallbackType is the same as FileType, disabling the fallback writer");
+      } else {
+        m_fallback = std::shared_ptr<eudaq::FileWriter>(FileWriterFactory::Create(m_fallback_type, &m_config));
+        m_fallback->SetFilePattern(m_config.Get("FilePattern", ""));
+      }
+    }
+    if (m_async) {
+      EUDAQ_INFO("Asynchronous writing with queue watermarks " + to_string(m_queue_low) + "/" + to_string(m_queue_high)
+                 + (m_fallback ? ", fallback writer: " + m_fallback_type : ""));
+      StartWriter();
+    }
   }
 
   void DataCollector::OnPrepareRun(unsigned runnumber) {
@@ -80,18 +136,35 @@ namespace eudaq {
       if (!m_writer) {
         EUDAQ_THROW("You must configure before starting a run");
       }
+      // events of the previous run still have to go into the previous file
+      DrainWriter();
       m_writer->StartRun(runnumber);
+      m_fallback_started = false;
+      m_bore.reset();
+      {
+        std::lock_guard<std::mutex> lock(m_queue_mutex);
+        m_queue_peak = m_n_blocked = m_n_overflows = m_n_fallback = 0;
+        m_blocked_time = 0;
+      }
       WriteToFile(m_runnumberfile, runnumber);
+      std::lock_guard<std::mutex> lock(m_buffer_mutex);
       m_runnumber = runnumber;
       m_eventnumber = 0;
 
       for (size_t i = 0; i < m_buffer.size(); ++i) {
-        if (m_buffer[i].events.size() > 0) {
-          EUDAQ_WARN("Buffer " + to_string(*m_buffer[i].id) + " has " + to_string(m_buffer[i].events.size()) + " events remaining.");
-          m_buffer[i].events.clear();
+        Info & inf = m_buffer[i];
+        if (inf.events.size() > 0) {
+          EUDAQ_WARN("Buffer " + to_string(*inf.id) + " has " + to_string(inf.events.size()) + " events remaining.");
         }
+        inf.events.reset(m_queue_size);
+        inf.n_received = inf.n_missing = 0;
+        inf.peak = 0;
+        inf.last = 0;
       }
+      RemoveClosed();
       m_numwaiting = 0;
+      m_bytes = 0;
+      m_n_incomplete = 0;
 
       SetStatus(Status::LVL_OK);
     } catch (const Exception & e) {
@@ -108,28 +181,38 @@ namespace eudaq {
   }
 
   void DataCollector::OnReceive(const ConnectionInfo & id, std::shared_ptr<Event> ev) {
-    Info & inf = m_buffer[GetInfo(id)];
-    inf.events.push_back(ev);
+    {
+      std::lock_guard<std::mutex> lock(m_buffer_mutex);
+      size_t bytes = m_received_bytes;
+      m_received_bytes = 0;
+      Receive(GetInfo(id), ev, bytes);
+    }
+    WriteBuilt();
+  }
+
+  void DataCollector::Receive(size_t slot, const std::shared_ptr<Event> & ev, size_t bytes) {
+    Info & inf = m_buffer[slot];
+    if (inf.events.empty())
+      m_numwaiting++;
+    // BuildEvents() never leaves a queue full
+    Entry entry = { ev, Time::Current().Seconds(), bytes };
+    inf.events.push(entry);
+    m_bytes += bytes;
+    ++inf.n_received;
+    inf.peak = std::max(inf.peak, inf.events.size());
+    if (!ev->IsBORE() && !ev->IsEORE())
+      inf.last = ev->GetEventNumber();
 
     // Print if the received event is the EORE of this producer:
-    if(inf.events.back()->IsEORE()) std::cout << "Received EORE Event from " << id << ": " << *ev << std::endl;
+    if (ev->IsEORE()) std::cout << "Received EORE Event from " << *inf.id << ": " << *ev << std::endl;
 
-    bool tmp = false;
-    if (inf.events.size() == 1) {
-      m_numwaiting++;
-      if (m_numwaiting == m_buffer.size()) {
-        tmp = true;
-      }
-    }
     if (m_eventnumber < 30 || m_eventnumber%100==0){
     	std::cout<<"\rWaiting Buffers: "<< m_numwaiting << " out of " << m_buffer.size()<<":";
     	for (unsigned i = 0; i< m_buffer.size(); i++)
     		std::cout<<" "<<m_buffer.at(i).events.size();
         std::cout<<std::flush;;
     }
-    //std::cout << "Waiting buffers: " << m_numwaiting << " out of " << m_buffer.size() << std::endl;
-    if (tmp)
-      OnCompleteEvent();
+    BuildEvents();
   }
 
   void DataCollector::OnStatus() {
@@ -140,82 +223,359 @@ namespace eudaq {
     m_status.SetTag("RUN", to_string(m_runnumber));
     if (m_writer.get())
       m_status.SetTag("FILEBYTES", to_string(m_writer->FileBytes()));
+    if (m_async) {
+      std::lock_guard<std::mutex> lock(m_queue_mutex);
+      m_status.SetTag("QUEUE", to_string(m_n_queued));
+      m_status.SetTag("QUEUEPEAK", to_string(m_queue_peak));
+      m_status.SetTag("OVERFLOWS", to_string(m_n_overflows));
+      m_status.SetTag("BLOCKED", to_string(m_n_blocked));
+      m_status.SetTag("BLOCKEDTIME", to_string(m_blocked_time));
+      m_status.SetTag("FALLBACK", to_string(m_n_fallback));
+    }
+    std::lock_guard<std::mutex> lock(m_buffer_mutex);
+    unsigned newest = 0;
+    for (size_t i = 0; i < m_buffer.size(); ++i)
+      newest = std::max(newest, m_buffer[i].last);
+    for (size_t i = 0; i < m_buffer.size(); ++i) {
+      const Info & inf = m_buffer[i];
+      if (inf.closed)
+        continue;
+      m_status.SetTag("QUEUED_" + inf.name, to_string(inf.events.size()));
+      m_status.SetTag("QUEUEPEAK_" + inf.name, to_string(inf.peak));
+      m_status.SetTag("LAG_" + inf.name, to_string(newest - inf.last));
+      m_status.SetTag("MISSING_" + inf.name, to_string(inf.n_missing));
+    }
+    m_status.SetTag("INCOMPLETE", to_string(m_n_incomplete));
+    m_status.SetTag("BUILDBYTES", to_string(m_bytes));
   }
 
   void DataCollector::OnCompleteEvent() {
-    bool more = true;
-    bool found_bore = false;
+    {
+      std::lock_guard<std::mutex> lock(m_buffer_mutex);
+      BuildEvents();
+    }
+    WriteBuilt();
+  }
 
-    while (more) {
-      if (m_eventnumber < 10 || m_eventnumber % 1000 == 0) {
-        std::cout << "Complete Event: " << m_runnumber << "." << m_eventnumber << std::endl;
-      }
-      unsigned n_run = m_runnumber, n_ev = m_eventnumber;
-      uint64_t n_ts = (uint64_t) -1;
-      if (m_itlu != (size_t) -1) {
-        TLUEvent * ev = static_cast<TLUEvent*>(m_buffer[m_itlu].events.front().get());
-        n_run = ev->GetRunNumber();
-        n_ev = ev->GetEventNumber();
-        n_ts = ev->GetTimestamp();
+  namespace {
+    /** sort key of an event: BOREs first, then the data events by event number, then the EOREs */
+    inline int EventRank(const Event & ev) {
+      return ev.IsBORE() ? 0 : ev.IsEORE() ? 2 : 1;
+    }
+  }
+
+  void DataCollector::BuildEvents() {
+    for (;;) {
+      RemoveClosed();
+      if (m_numwaiting == 0)
+        return;
+      const char * reason = 0;
+      if (m_numwaiting == m_buffer.size()) {
+        reason = CheckAlignment();
+        if (!reason) {
+          m_take.assign(m_buffer.size(), 1);
+          BuildEvent(m_take, 0);
+          continue;
+        }
+      } else {
+        reason = CheckPressure();
+        if (!reason)
+          return;
       }
-      DetectorEvent ev(n_run, n_ev, n_ts);
+      // resync: build the oldest buffered event from the producers that have it
+      int rank = 3;
+      unsigned number = 0;
       for (size_t i = 0; i < m_buffer.size(); ++i) {
-        if (m_buffer[i].events.front()->GetRunNumber() != m_runnumber) {
-          EUDAQ_ERROR("Run number mismatch in event " + to_string(ev.GetEventNumber()));
-        }
-        std::cout << "buffere event nr: " << m_buffer[i].events.front()->GetEventNumber() << " m_ev nr: " << m_eventnumber << std::endl;
-        if ((m_buffer[i].events.front()->GetEventNumber() != m_eventnumber) && (m_buffer[i].events.front()->GetEventNumber() != m_eventnumber - 1)) {
-          if (ev.GetEventNumber() % 1000 == 0) {
-            // dhaas: added if-statement to filter out TLU event number 0, in case of bad clocking out
-            if (m_buffer[i].events.front()->GetEventNumber() != 0)
-              EUDAQ_WARN("Event number mismatch > 2 in event " + to_string(ev.GetEventNumber()) + " " + to_string(m_buffer[i].events.front()->GetEventNumber()) + " " + to_string(m_eventnumber));
-            if (m_buffer[i].events.front()->GetEventNumber() == 0)
-              EUDAQ_WARN("Event number mismatch > 2 in event " + to_string(ev.GetEventNumber()));
-          }
-        }
-        ev.AddEvent(m_buffer[i].events.front());
-        m_buffer[i].events.pop_front();
-        if (m_buffer[i].events.size() == 0) {
-          m_numwaiting--;
-          more = false;
+        if (m_buffer[i].events.empty())
+          continue;
+        const Event & ev = *m_buffer[i].events.front().ev;
+        int r = EventRank(ev);
+        if (r < rank || (r == rank && ev.GetEventNumber() < number)) {
+          rank = r;
+          number = ev.GetEventNumber();
         }
       }
-      if (ev.IsBORE()) {
-        ev.SetTag("STARTTIME", m_runstart.Formatted());
-        ev.SetTag("CONFIG", to_string(m_config));
-	found_bore = true;
+      m_take.assign(m_buffer.size(), 0);
+      for (size_t i = 0; i < m_buffer.size(); ++i) {
+        if (m_buffer[i].events.empty())
+          continue;
+        const Event & ev = *m_buffer[i].events.front().ev;
+        m_take[i] = EventRank(ev) == rank && (rank != 1 || ev.GetEventNumber() == number);
+      }
+      BuildEvent(m_take, reason);
+    }
+  }
+
+  const char * DataCollector::CheckAlignment() {
+    const Event & ev0 = *m_buffer[0].events.front().ev;
+    int rank = EventRank(ev0);
+    unsigned lo = ev0.GetEventNumber(), hi = lo;
+    for (size_t i = 1; i < m_buffer.size(); ++i) {
+      const Event & ev = *m_buffer[i].events.front().ev;
+      if (EventRank(ev) != rank)
+        return "BORE/EORE mismatch";
+      lo = std::min(lo, ev.GetEventNumber());
+      hi = std::max(hi, ev.GetEventNumber());
+    }
+    if (rank == 1 && m_max_mismatch >= 0 && hi - lo > unsigned(m_max_mismatch))
+      return "event number mismatch";
+    return 0;
+  }
+
+  const char * DataCollector::CheckPressure() {
+    double oldest = -1;
+    for (size_t i = 0; i < m_buffer.size(); ++i) {
+      Info & inf = m_buffer[i];
+      if (inf.events.empty())
+        continue;
+      if (inf.closed)
+        return "producer disconnected";
+      if (inf.events.full())
+        return "queue full";
+      if (oldest < 0 || inf.events.front().time < oldest)
+        oldest = inf.events.front().time;
+    }
+    if (m_max_bytes && m_bytes > m_max_bytes)
+      return "memory limit";
+    if (m_timeout > 0 && oldest >= 0 && Time::Current().Seconds() - oldest > m_timeout)
+      return "timeout";
+    return 0;
+  }
+
+  void DataCollector::BuildEvent(const std::vector<char> & take, const char * reason) {
+    if (m_eventnumber < 10 || m_eventnumber % 1000 == 0) {
+      std::cout << (reason ? "Incomplete Event: " : "Complete Event: ") << m_runnumber << "." << m_eventnumber << std::endl;
+    }
+    unsigned n_run = m_runnumber, n_ev = m_eventnumber;
+    uint64_t n_ts = NOTIMESTAMP;
+    if (m_itlu != (size_t) -1 && take[m_itlu]) {
+      TLUEvent * ev = static_cast<TLUEvent*>(m_buffer[m_itlu].events.front().ev.get());
+      n_run = ev->GetRunNumber();
+      n_ev = ev->GetEventNumber();
+      n_ts = ev->GetTimestamp();
+    }
+    std::shared_ptr<DetectorEvent> ev = std::make_shared<DetectorEvent>(n_run, n_ev, n_ts);
+    std::string missing;
+    for (size_t i = 0; i < m_buffer.size(); ++i) {
+      Info & inf = m_buffer[i];
+      if (!take[i]) {
+        ++inf.n_missing;
+        missing += (missing.empty() ? "" : " ") + inf.name;
+        continue;
       }
-      if (ev.IsEORE()) {
-        ev.SetTag("STOPTIME", Time::Current().Formatted());
-        EUDAQ_INFO("Run " + to_string(ev.GetRunNumber()) + ", EORE = " + to_string(ev.GetEventNumber()));
+      Entry & entry = inf.events.front();
+      if (entry.ev->GetRunNumber() != m_runnumber) {
+        EUDAQ_ERROR("Run number mismatch in event " + to_string(ev->GetEventNumber()));
       }
+      if ((entry.ev->GetEventNumber() != m_eventnumber) && (entry.ev->GetEventNumber() != m_eventnumber - 1)) {
+        if (ev->GetEventNumber() % 1000 == 0) {
+          // dhaas: added if-statement to filter out TLU event number 0, in case of bad clocking out
+          if (entry.ev->GetEventNumber() != 0)
+            EUDAQ_WARN("Event number mismatch > 2 in event " + to_string(ev->GetEventNumber()) + " " + to_string(entry.ev->GetEventNumber()) + " " + to_string(m_eventnumber));
+          if (entry.ev->GetEventNumber() == 0)
+            EUDAQ_WARN("Event number mismatch > 2 in event " + to_string(ev->GetEventNumber()));
+        }
+      }
+      ev->AddEvent(entry.ev);
+      m_bytes -= entry.bytes;
+      inf.events.pop();
+      if (inf.events.empty())
+        m_numwaiting--;
+    }
+    if (reason) {
+      ev->SetFlags(Event::FLAG_INCOMPLETE);
+      ev->SetTag("MISSING", missing);
+      if (m_n_incomplete < 10 || m_n_incomplete % 1000 == 0)
+        EUDAQ_WARN("Incomplete event " + to_string(ev->GetEventNumber()) + " (" + reason + "), missing: " + missing
+                   + " [" + to_string(m_n_incomplete + 1) + " so far]");
+      ++m_n_incomplete;
+    }
+    if (ev->IsBORE()) {
+      ev->SetTag("STARTTIME", m_runstart.Formatted());
+      ev->SetTag("CONFIG", to_string(m_config));
+    }
+    if (ev->IsEORE()) {
+      ev->SetTag("STOPTIME", Time::Current().Formatted());
+      EUDAQ_INFO("Run " + to_string(ev->GetRunNumber()) + ", EORE = " + to_string(ev->GetEventNumber()));
+    }
+    // Only increase the internal event counter for non-BORE events.
+    // This is required since all producers start sending data with event ID 0
+    // but the data collector would already be at 1, since BORE was 0.
+    if (!ev->IsBORE()) ++m_eventnumber;
+    m_built.push_back(ev);
+  }
+
+  void DataCollector::RemoveClosed() {
+    bool removed = false;
+    for (size_t i = m_buffer.size(); i-- > 0;) {
+      if (m_buffer[i].closed && m_buffer[i].events.empty()) {
+        m_buffer.erase(m_buffer.begin() + i);
+        removed = true;
+      }
+    }
+    if (!removed)
+      return;
+    m_slots.clear();
+    m_itlu = (size_t) -1;
+    for (size_t i = 0; i < m_buffer.size(); ++i) {
+      const ConnectionInfo & id = *m_buffer[i].id;
+      if (!m_buffer[i].closed)
+        m_slots[id.Hash()] = i;
+      if (id.GetType() == "Producer" && id.GetName() == "TU")
+        m_itlu = i;
+    }
+  }
+
+  void DataCollector::WriteBuilt() {
+    {
+      std::lock_guard<std::mutex> lock(m_buffer_mutex);
+      m_writing.swap(m_built);
+    }
+    for (size_t i = 0; i < m_writing.size(); ++i) {
       if (m_writer.get()) {
-	try{
-	  m_writer->WriteEvent(ev);
-	}
-	catch(const Exception & e){
-	  std::string msg = "Exception writing to file: "; msg+= e.what();
-	  EUDAQ_ERROR(msg);
-	  SetStatus(Status::LVL_ERROR, msg);
-	}
+        WriteEvent(m_writing[i]);
       } else {
         EUDAQ_ERROR("Event received before start of run");
       }
+    }
+    m_writing.clear();
+  }
 
-      // Only increase the internal event counter for non-BORE events.
-      // This is required since all producers start sending data with event ID 0
-      // but the data collector would already be at 1, since BORE was 0.
-      if(!found_bore) ++m_eventnumber;
+  void DataCollector::WriteEvent(const std::shared_ptr<DetectorEvent> & qev) {
+    const DetectorEvent & ev = *qev;
+    if (!m_async) {
+      try {
+        m_writer->WriteEvent(ev);
+      }
+      catch (const Exception & e) {
+        std::string msg = "Exception writing to file: "; msg += e.what();
+        EUDAQ_ERROR(msg);
+        SetStatus(Status::LVL_ERROR, msg);
+      }
+      return;
     }
+    if (ev.IsBORE())
+      m_bore = qev;
+    std::unique_lock<std::mutex> lock(m_queue_mutex);
+    // BORE and EORE always go into the main file
+    if (!ev.IsBORE() && !ev.IsEORE() && (m_overflow || m_n_queued >= m_queue_high)) {
+      if (!m_overflow) {
+        m_overflow = true;
+        ++m_n_overflows;
+        EUDAQ_WARN("Writer queue full (" + to_string(m_n_queued) + " events) at event " + to_string(ev.GetEventNumber())
+                   + (m_fallback ? ", writing raw data to the fallback file" : ", blocking until it drains"));
+      }
+      if (m_fallback) {
+        ++m_n_fallback;
+        lock.unlock();
+        WriteFallback(ev);
+        return;
+      }
+      ++m_n_blocked;
+      Timer timer;
+      m_cv_space.wait(lock, [this] { return !m_overflow || m_writer_done; });
+      m_blocked_time += timer.Seconds();
+    }
+    m_queue.push_back(qev);
+    m_queue_peak = std::max(m_queue_peak, ++m_n_queued);
+    lock.unlock();
+    m_cv_queue.notify_one();
+    if (ev.IsEORE() && m_fallback_started)
+      WriteFallback(ev);
   }
 
-  size_t DataCollector::GetInfo(const ConnectionInfo & id) {
+  void DataCollector::WriteFallback(const DetectorEvent & ev) {
+    try {
+      if (!m_fallback_started) {
+        m_fallback->StartRun(m_runnumber);
+        if (m_bore)
+          m_fallback->WriteEvent(*m_bore);
+        m_fallback_started = true;
+      }
+      m_fallback->WriteEvent(ev);
+    }
+    catch (const Exception & e) {
+      std::string msg = "Exception writing to fallback file: "; msg += e.what();
+      EUDAQ_ERROR(msg);
+      SetStatus(Status::LVL_ERROR, msg);
+    }
+  }
+
+  void DataCollector::StartWriter() {
+    if (m_writer_thread)
+      return;
+    m_writer_done = false;
+    m_overflow = false;
+    m_writer_thread = std::unique_ptr<std::thread>(new std::thread(DataCollector_writer_thread, this));
+  }
+
+  void DataCollector::StopWriter() {
+    if (!m_writer_thread)
+      return;
+    {
+      std::lock_guard<std::mutex> lock(m_queue_mutex);
+      m_writer_done = true;
+    }
+    m_cv_queue.notify_all();
+    m_cv_space.notify_all();
+    m_writer_thread->join();
+    m_writer_thread.reset();
+  }
+
+  void DataCollector::DrainWriter() {
+    std::unique_lock<std::mutex> lock(m_queue_mutex);
+    m_cv_space.wait(lock, [this] { return m_n_queued == 0 || !m_writer_thread; });
+  }
+
+  void DataCollector::WriterThread() {
+    std::vector<std::shared_ptr<DetectorEvent> > batch;
+    std::unique_lock<std::mutex> lock(m_queue_mutex);
+    while (true) {
+      m_cv_queue.wait(lock, [this] { return m_writer_done || !m_queue.empty(); });
+      // the queue is always written out completely before the thread ends
+      if (m_queue.empty())
+        break;
+      batch.swap(m_queue);
+      lock.unlock();
+      for (size_t i = 0; i < batch.size(); ++i) {
+        try {
+          m_writer->WriteEvent(*batch[i]);
+        }
+        catch (const Exception & e) {
+          std::string msg = "Exception writing to file: "; msg += e.what();
+          EUDAQ_ERROR(msg);
+          SetStatus(Status::LVL_ERROR, msg);
+        }
+        batch[i].reset();
+        lock.lock();
+        --m_n_queued;
+        if (m_overflow && m_n_queued <= m_queue_low)
+          m_overflow = false;
+        lock.unlock();
+        m_cv_space.notify_all();
+      }
+      batch.clear();
+      lock.lock();
+    }
+  }
+
+  size_t DataCollector::FindInfo(const ConnectionInfo & id) {
+    std::unordered_map<size_t, size_t>::const_iterator it = m_slots.find(id.Hash());
+    if (it != m_slots.end() && m_buffer[it->second].id->Matches(id))
+      return it->second;
     for (size_t i = 0; i < m_buffer.size(); ++i) {
       //std::cout << "Checking " << *m_buffer[i].id << " == " << id<< std::endl;
-      if (m_buffer[i].id->Matches(id))
+      if (!m_buffer[i].closed && m_buffer[i].id->Matches(id))
         return i;
     }
-    EUDAQ_THROW("Unrecognised connection id");
+    return (size_t) -1;
+  }
+
+  size_t DataCollector::GetInfo(const ConnectionInfo & id) {
+    size_t i = FindInfo(id);
+    if (i == (size_t) -1)
+      EUDAQ_THROW("Unrecognised connection id");
+    return i;
   }
 
   void DataCollector::DataHandler(TransportEvent & ev) {
@@ -277,11 +637,22 @@ namespace eudaq {
           //    std::cout << to_hex(ev.packet[i], 2) << ' ';
           //}
           //std::cout << ")" << std::endl;
-          BufferSerializer ser(ev.packet.begin(), ev.packet.end());
-          //std::cout << "Deserializing" << std::endl;
-          std::shared_ptr<Event> event(EventFactory::Create(ser));
-          //std::cout << "Done" << std::endl;
-          OnReceive(ev.id, event);
+          // raw data blocks keep referencing the receive buffer instead of being copied,
+          // without an owner (packet string) they are copied out of it
+          const unsigned char * data = ev.view.empty() ? reinterpret_cast<const unsigned char *>(ev.packet.data()) : ev.view.data;
+          size_t len = ev.view.empty() ? ev.packet.size() : ev.view.size;
+          std::vector<std::pair<const unsigned char *, size_t> > batch;
+          if (!DataSender::SplitBatch(data, len, batch)) batch.push_back(std::make_pair(data, len));
+          // every event goes through OnReceive, which looks up the producer again since
+          // building an event may remove closed producers and shift the slots
+          for (size_t i = 0; i < batch.size(); ++i) {
+            SharedBufferDeserializer ser(batch[i].first, batch[i].second, ev.view.owner);
+            std::shared_ptr<Event> event(EventFactory::Create(ser));
+            //std::cout << "Done" << std::endl;
+            m_received_bytes = batch[i].second;
+            OnReceive(ev.id, event);
+            m_received_bytes = 0;
+          }
           //std::cout << "End" << std::endl;
         }
         break;
@@ -294,6 +665,8 @@ namespace eudaq {
     try {
       while (!m_done) {
         m_dataserver->Process(100000);
+        // builds the incomplete events that timed out while no data arrived
+        OnCompleteEvent();
       }
     } catch (const std::exception & e) {
       std::cout << "Error: Uncaught exception: " << e.what() << "\n" << "DataThread is dying..." << std::endl;
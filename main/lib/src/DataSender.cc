@@ -5,18 +5,58 @@
 #include "eudaq/Exception.hh"
 #include "eudaq/BufferSerializer.hh"
 #include "eudaq/Logger.hh"
+#include "eudaq/Configuration.hh"
+#include "eudaq/Status.hh"
+#include "eudaq/Time.hh"
+#include "eudaq/Utils.hh"
 #include "eudaq/DataSender.hh"
 
 namespace eudaq {
 
+  namespace {
+
+    /** A batch packet: BATCH_ID, number of events, then for each event its length and its serialized bytes */
+    static const uint32_t BATCH_ID = 0x5441425f; // "_BAT", never the id of an event type
+    static const size_t MAX_SEALED_BATCHES = 64;  ///< SendEvent blocks while more batches are waiting
+
+    static void put_u32(std::vector<unsigned char> & buf, size_t pos, uint32_t val) {
+      for (int i = 0; i < 4; ++i) {
+        buf[pos + i] = static_cast<unsigned char>(val & 0xff);
+        val >>= 8;
+      }
+    }
+
+    static uint32_t get_u32(const unsigned char * data) {
+      return data[0] | (data[1] << 8) | (data[2] << 16) | (uint32_t(data[3]) << 24);
+    }
+
+    /** Appends to a vector that is kept (and its capacity reused) by the caller */
+    class AppendSerializer : public Serializer {
+      public:
+        explicit AppendSerializer(std::vector<unsigned char> & data) : m_data(data) {}
+      private:
+        virtual void Serialize(const unsigned char * data, size_t len) { m_data.insert(m_data.end(), data, data + len); }
+        std::vector<unsigned char> & m_data;
+    };
+
+  }
+
   DataSender::DataSender(const std::string & type, const std::string & name)
     : m_type(type),
     m_name(name),
-    m_dataclient(0) {}
+    m_dataclient(0),
+    m_batch_events(0), m_batch_bytes(0), m_batch_delay(0),
+    m_stop_sender(false), m_batching(false), m_open_events(0), m_open_time(0), m_sending(false),
+    m_n_events(0), m_n_bytes(0), m_n_batches(0), m_n_errors(0),
+    m_queued(0), m_queue_peak(0), m_last_events(0), m_last_bytes(0),
+    m_last_time(Time::Current().Seconds()) {}
 
   void DataSender::Connect(const std::string & server) {
+    FlushBatch();
+    std::lock_guard<std::mutex> lock(m_send_mutex); // the sender thread must not use the client meanwhile
     delete m_dataclient;
     m_dataclient = TransportFactory::CreateClient(server);
+    m_dataclient->SetNoDelay(m_batch_events != 0);
 
     std::string packet;
     if (!m_dataclient->ReceivePacket(&packet, 1000000)) EUDAQ_THROW("No response from DataCollector server");
@@ -50,26 +90,193 @@ namespace eudaq {
 
   void DataSender::SendEvent(const Event &ev) {
     if (!m_dataclient) EUDAQ_THROW("Transport not connected error");
-    //EUDAQ_DEBUG("Serializing event");
-    BufferSerializer ser;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv_done.wait(lock, [this] { return m_sealed.size() < MAX_SEALED_BATCHES || !m_batching; });
+    if (!m_batching) {
+      // no sender thread (any more) and everything it had is sent. A sender thread started meanwhile
+      // waits for the send lock, so m_mutex (and with it FillStatus) doesn't wait for the network.
+      std::unique_lock<std::mutex> send_lock(m_send_mutex);
+      lock.unlock();
+      //EUDAQ_DEBUG("Serializing event");
+      BufferSerializer ser;
+      ev.Serialize(ser);
+      //EUDAQ_DEBUG("Sending event");
+      m_dataclient->SendPacket(ser);
+      //EUDAQ_DEBUG("Sent event");
+      send_lock.unlock();
+      lock.lock();
+      ++m_n_events;
+      m_n_bytes += ser.size();
+      return;
+    }
+    if (m_open.empty()) {
+      m_open.resize(8);
+      put_u32(m_open, 0, BATCH_ID);
+      m_open_time = Time::Current().Seconds();
+    }
+    size_t start = m_open.size();
+    m_open.resize(start + 4);
+    AppendSerializer ser(m_open);
     ev.Serialize(ser);
-    //EUDAQ_DEBUG("Sending event");
-    m_dataclient->SendPacket(ser);
-    //EUDAQ_DEBUG("Sent event");
+    put_u32(m_open, start, uint32_t(m_open.size() - start - 4));
+    ++m_open_events;
+    m_queued++;
+    m_queue_peak = std::max(m_queue_peak, m_queued);
+    if (ev.IsBORE() || ev.IsEORE() || m_open_events >= m_batch_events || (m_batch_bytes && m_open.size() >= m_batch_bytes)) SealBatch();
+    else if (m_open_events == 1) m_cv_work.notify_one(); // starts the delay
+    if (ev.IsEORE()) m_cv_done.wait(lock, [this] { return (m_sealed.empty() && !m_sending) || !m_batching; });
+  }
+
+  void DataSender::SealBatch() {
+    if (m_open.empty()) return;
+    put_u32(m_open, 4, uint32_t(m_open_events));
+    m_sealed.push_back(std::vector<unsigned char>());
+    m_sealed.back().swap(m_open);
+    if (!m_free.empty()) {
+      m_open.swap(m_free.back());
+      m_free.pop_back();
+    }
+    m_open.clear();
+    m_open_events = 0;
+    m_cv_work.notify_one();
+  }
+
+  void DataSender::SenderThread() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+      if (m_sealed.empty() && !m_open.empty()) {
+        double due = m_open_time + m_batch_delay * 1e-3 - Time::Current().Seconds();
+        if (due <= 0 || m_stop_sender) SealBatch();
+        else m_cv_work.wait_for(lock, std::chrono::microseconds(int64_t(due * 1e6) + 1));
+        continue;
+      }
+      if (m_sealed.empty()) {
+        if (m_stop_sender) {
+          // cleared only here, with nothing left: later events are sent directly and cannot get stuck in m_open
+          m_batching = false;
+          m_cv_done.notify_all();
+          break;
+        }
+        m_cv_work.wait(lock);
+        continue;
+      }
+      std::vector<unsigned char> batch;
+      batch.swap(m_sealed.front());
+      m_sealed.pop_front();
+      m_sending = true;
+      lock.unlock();
+      size_t n_events = get_u32(&batch[4]);
+      bool ok = true;
+      try {
+        std::lock_guard<std::mutex> send_lock(m_send_mutex);
+        m_dataclient->SendPacket(&batch[0], batch.size());
+      } catch (const std::exception & e) {
+        EUDAQ_ERROR("Error sending batch of " + to_string(n_events) + " events: " + e.what());
+        ok = false;
+      }
+      lock.lock();
+      m_sending = false;
+      m_queued -= n_events;
+      if (ok) {
+        m_n_events += n_events;
+        m_n_bytes += batch.size();
+        ++m_n_batches;
+      } else {
+        m_n_errors += n_events;
+      }
+      batch.clear();
+      if (m_free.size() < MAX_SEALED_BATCHES) m_free.push_back(std::move(batch));
+      m_cv_done.notify_all();
+    }
+  }
+
+  void DataSender::SetBatching(size_t max_events, unsigned max_delay_ms, size_t max_bytes) {
+    StopSender();
+    {
+      // the batches are the coalescing, a late flush must not wait for the ack of the previous packet
+      std::lock_guard<std::mutex> send_lock(m_send_mutex);
+      if (m_dataclient) m_dataclient->SetNoDelay(max_events != 0);
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_batch_events = max_events;
+    m_batch_delay = max_delay_ms;
+    m_batch_bytes = max_bytes;
+    if (!max_events) return;
+    m_stop_sender = false;
+    m_batching = true;
+    m_sender = std::unique_ptr<std::thread>(new std::thread(&DataSender::SenderThread, this));
+  }
+
+  void DataSender::SetBatching(const Configuration & conf) {
+    SetBatching(conf.Get("BatchEvents", 0), conf.Get("BatchDelay", 10), conf.Get("BatchBytes", 1 << 20));
+  }
+
+  void DataSender::FlushBatch() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_batching) return;
+    SealBatch();
+    m_cv_done.wait(lock, [this] { return (m_sealed.empty() && !m_sending) || !m_batching; });
+  }
+
+  void DataSender::StopSender() {
+    if (!m_sender) return;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop_sender = true;
+      m_cv_work.notify_one();
+    }
+    m_sender->join(); // the thread sends what is left and clears m_batching
+    m_sender.reset();
   }
 
+  void DataSender::FillStatus(Status & status) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    double now = Time::Current().Seconds(), dt = now - m_last_time;
+    if (dt > 0) {
+      status.SetTag("SENDRATE", to_string((m_n_events - m_last_events) / dt));
+      status.SetTag("SENDMBPS", to_string((m_n_bytes - m_last_bytes) / dt / 1e6));
+    }
+    m_last_time = now;
+    m_last_events = m_n_events;
+    m_last_bytes = m_n_bytes;
+    status.SetTag("SENT", to_string(m_n_events));
+    if (m_batch_events) {
+      status.SetTag("SENDQUEUE", to_string(m_queued));
+      status.SetTag("SENDQUEUEPEAK", to_string(m_queue_peak));
+      status.SetTag("BATCHES", to_string(m_n_batches));
+      status.SetTag("SENDERRORS", to_string(m_n_errors));
+    }
+  }
+
+  bool DataSender::SplitBatch(const unsigned char * data, size_t len, std::vector<std::pair<const unsigned char *, size_t> > & events) {
+    events.clear();
+    if (len < 8 || get_u32(data) != BATCH_ID) return false;
+    size_t n = get_u32(data + 4), pos = 8;
+    for (size_t i = 0; i < n; ++i) {
+      if (pos + 4 > len) EUDAQ_THROW("Truncated event batch");
+      size_t size = get_u32(data + pos);
+      pos += 4;
+      if (pos + size > len) EUDAQ_THROW("Truncated event batch");
+      events.push_back(std::make_pair(data + pos, size));
+      pos += size;
+    }
+    return true;
+  }
 
   void DataSender::SendPacket(const AidaPacket &packet) {
+    FlushBatch(); // keep the order, and the sender thread is idle afterwards
 //    EUDAQ_DEBUG("Serializing packet");
     BufferSerializer ser;
     packet.Serialize(ser);
 //    EUDAQ_DEBUG("Sending packet");
+    std::lock_guard<std::mutex> send_lock(m_send_mutex);
     m_dataclient->SendPacket(ser);
 //    EUDAQ_DEBUG("Sent packet");
   }
 
 
   DataSender::~DataSender() {
+    StopSender();
     delete m_dataclient;
   }
 
@@ -14,7 +14,10 @@ namespace eudaq {
       "EORE",
       "HITS",
       "FAKE",
-      "SIMU"
+      "SIMU",
+      "EUDAQ2",
+      "PACKET",
+      "INCOMPLETE"
     };
 
   }
@@ -293,6 +293,16 @@ void SyncBase::clearDetectorQueue()
 
 }
 
+void SyncBase::clearQueues()
+{
+	for (auto& q : m_ProducerEventQueue)
+	{
+		eventqueue_t empty;
+		std::swap(q, empty);
+	}
+	clearDetectorQueue();
+}
+
 void SyncBase::PrepareForEvents()
 {
 
@@ -0,0 +1,109 @@
+#include "eudaq/FileIndex.hh"
+#include "eudaq/FileSerializer.hh"
+#include "eudaq/Event.hh"
+#include "eudaq/Logger.hh"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+namespace eudaq {
+
+  namespace {
+    static const unsigned INDEX_VERSION = 1;
+  }
+
+  FileIndex::FileIndex(const std::string & rawfile) : m_rawfile(rawfile), m_complete(false), m_filesize(0) {}
+
+  uint64_t FileIndex::RawFileSize() const {
+    struct stat st;
+    if (stat(m_rawfile.c_str(), &st) != 0) return 0;
+    return st.st_size;
+  }
+
+  bool FileIndex::Load() {
+    Clear();
+    try {
+      FileDeserializer des(IndexName(m_rawfile), true);
+      unsigned tag = 0, version = 0, n = 0;
+      uint64_t filesize = 0;
+      des.read(tag);
+      des.read(version);
+      des.read(filesize);
+      if (tag != Event::str2id("EIDX") || version != INDEX_VERSION || filesize != RawFileSize()) return false;
+      m_filesize = filesize;
+      des.read(n);
+      m_entries.resize(n);
+      for (size_t i = 0; i < n; ++i) {
+        des.read(m_entries[i].event);
+        des.read(m_entries[i].offset);
+        des.read(m_entries[i].timestamp);
+        des.read(m_entries[i].flags);
+      }
+    } catch (const Exception &) {
+      Clear();
+      return false;
+    }
+    m_complete = true;
+    return true;
+  }
+
+  bool FileIndex::Save() {
+    // a built index covers the file as it was when the scan started, a recorded one the file as it is now
+    if (!m_complete) m_filesize = RawFileSize();
+    try {
+      FileSerializer ser(IndexName(m_rawfile), true, 1 << 20);
+      ser.write(Event::str2id("EIDX"));
+      ser.write(INDEX_VERSION);
+      ser.write(m_filesize);
+      ser.write(unsigned(m_entries.size()));
+      for (size_t i = 0; i < m_entries.size(); ++i) {
+        ser.write(m_entries[i].event);
+        ser.write(m_entries[i].offset);
+        ser.write(m_entries[i].timestamp);
+        ser.write(m_entries[i].flags);
+      }
+      ser.Commit();
+    } catch (const Exception & e) {
+      EUDAQ_INFO("Unable to write event index " + IndexName(m_rawfile) + ": " + e.what());
+      return false;
+    }
+    m_complete = true;
+    return true;
+  }
+
+  void FileIndex::Build() {
+    Clear();
+    m_filesize = RawFileSize();
+    // mapped, so that the raw data blocks are not copied while scanning
+    FileDeserializer des(m_rawfile, true, 65536, true);
+    try {
+      while (des.HasData()) {
+        uint64_t offset = des.Tell();
+        std::shared_ptr<Event> ev(EventFactory::Create(des));
+        Add(*ev, offset);
+      }
+    } catch (const FileReadException &) {
+      // the last event is incomplete, the index covers everything before it
+    }
+    m_complete = true;
+  }
+
+  void FileIndex::Add(const Event & ev, uint64_t offset) {
+    Entry entry;
+    entry.event = ev.GetEventNumber();
+    entry.offset = offset;
+    entry.timestamp = ev.GetTimestamp();
+    entry.flags = ev.GetFlags(Event::FLAG_BORE | Event::FLAG_EORE);
+    m_entries.push_back(entry);
+  }
+
+  const FileIndex::Entry * FileIndex::Find(unsigned event) const {
+    // event numbers are increasing, apart from the BORE which shares its number with the first event
+    std::vector<Entry>::const_iterator it = std::lower_bound(m_entries.begin(), m_entries.end(), event,
+        [](const Entry & e, unsigned n) { return e.event < n || (e.flags & Event::FLAG_BORE); });
+    // only the event itself, not a later one or the EORE
+    if (it == m_entries.end() || it->event != event || (it->flags & Event::FLAG_EORE)) return 0;
+    return &*it;
+  }
+
+}
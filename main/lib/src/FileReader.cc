@@ -13,12 +13,18 @@ namespace eudaq {
 
 
 
-  FileReader::FileReader(const std::string & file, const std::string & filepattern)
+  FileReader::FileReader(const std::string & file, const std::string & filepattern, bool mapped)
     : m_filename(FileNamer(filepattern).Set('X', ".raw").SetReplace('R', file)),
-    m_des(m_filename),
+    m_des(m_filename, false, 65536, mapped),
     m_ev(EventFactory::Create(m_des)),
-    m_ver(1)
+    m_ver(1),
+    m_index(m_filename),
+    m_indexing(false)
     {
+      if (!m_index.Load()) {
+        m_index.Add(*m_ev, 0);
+        m_indexing = true;
+      }
       if (m_ev->GetRunNumber() > 2e9){
         EUDAQ_WARN("Error reading run number! Taking the one from the filename string!");
         std::cout << m_ev->GetRunNumber() << " -> ";
@@ -55,12 +61,38 @@ namespace eudaq {
   bool FileReader::NextEvent(size_t skip) {
     std::shared_ptr<eudaq::Event> ev = nullptr;
 
-
+    if (skip) m_indexing = false;
+    uint64_t offset = m_indexing ? m_des.Tell() : 0;
     bool result = m_des.ReadEvent(m_ver, ev, skip);
     if (ev) m_ev =  ev;
+    if (m_indexing) {
+      if (result) {
+        m_index.Add(*m_ev, offset);
+      } else {
+        // only a finished run is a complete pass, a file that is still being written may grow
+        const std::vector<FileIndex::Entry> & entries = m_index.Entries();
+        if (!entries.empty() && (entries.back().flags & Event::FLAG_EORE)) m_index.Save();
+        m_indexing = false;
+      }
+    }
     return result;
   }
 
+  bool FileReader::SeekEvent(unsigned n) {
+    const FileIndex::Entry * entry = m_index.Complete() ? m_index.Find(n) : 0;
+    if (!entry && (!m_index.Complete() || m_index.Stale())) {
+      // no index yet, or n is past its end and the file has changed since
+      m_index.Build();
+      m_index.Save();
+      m_indexing = false;
+      entry = m_index.Find(n);
+    }
+    if (!entry) return false;
+    m_des.Seek(entry->offset);
+    m_ev = std::shared_ptr<eudaq::Event>(EventFactory::Create(m_des));
+    return true;
+  }
+
   unsigned FileReader::RunNumber() const {
     return m_ev->GetRunNumber();
   }
@@ -3,15 +3,22 @@
 #include "eudaq/Platform.hh"
 #include "eudaq/Utils.hh"
 #include "eudaq/Event.hh"
+#include "eudaq/Time.hh"
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <iostream>
+#include <algorithm>
+#ifndef WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 
 namespace eudaq {
 
-  FileSerializer::FileSerializer(const std::string & fname, bool overwrite)
-    : m_file(0), m_filebytes(0)
+  FileSerializer::FileSerializer(const std::string & fname, bool overwrite, size_t buffersize)
+    : m_file(0), m_filebytes(0), m_bufsize(buffersize), m_committed(0), m_flush_records(1), m_n_records(0), m_flush_ms(0),
+      m_flush_bytes(0), m_lastflush_bytes(0), m_lastflush_time(Time::Current().Seconds()), m_flush_hist(24, 0)
   {
     if (!overwrite) {
       FILE * fd = fopen(fname.c_str(), "rb");
@@ -22,15 +29,35 @@ namespace eudaq {
     }
     m_file = fopen(fname.c_str(), "wb");
     if (!m_file) EUDAQ_THROWX(FileNotFoundException, "Unable to open file: " + fname);
+    if (m_bufsize) {
+      // we do our own buffering, avoid copying everything a second time into the stdio buffer
+      setvbuf(m_file, 0, _IONBF, 0);
+      m_buf.reserve(m_bufsize);
+    }
   }
 
   FileSerializer::~FileSerializer() {
     if (m_file) {
+      try {
+        Flush();
+      } catch (const Exception & e) {
+        std::cerr << e.what() << std::endl;
+      }
+      if (m_buf.size() > m_committed) {
+        // e.g. the serialization of an event threw, it must not end up half written in the file
+        EUDAQ_WARN("Discarding " + to_string(m_buf.size() - m_committed) + " bytes of an incomplete record");
+      }
       fclose(m_file);
     }
   }
 
   void FileSerializer::Serialize(const unsigned char * data, size_t len) {
+    if (m_bufsize) {
+      // the buffer grows if a single record is larger than the buffer size
+      m_buf.insert(m_buf.end(), data, data + len);
+      m_filebytes += len;
+      return;
+    }
     size_t written = std::fwrite(reinterpret_cast<const char *>(data), 1, len, m_file);
     m_filebytes += written;
     if (written != len) {
@@ -38,11 +65,83 @@ namespace eudaq {
     }
   }
 
+  void FileSerializer::WriteBuffer(size_t len) {
+    if (!len) return;
+    size_t written = std::fwrite(reinterpret_cast<const char *>(&m_buf[0]), 1, len, m_file);
+    if (written != len) {
+      EUDAQ_THROW("Error writing to file: " + to_string(errno) + ", " + strerror(errno));
+    }
+    m_buf.erase(m_buf.begin(), m_buf.begin() + len);
+    m_committed -= std::min(len, m_committed);
+  }
+
+  void FileSerializer::SetFlushPolicy(size_t n_records, unsigned t_ms, uint64_t n_bytes) {
+    m_flush_records = n_records;
+    m_flush_ms = t_ms;
+    m_flush_bytes = n_bytes;
+  }
+
+  void FileSerializer::Commit() {
+    ++m_n_records;
+    m_committed = m_buf.size();
+    double now = Time::Current().Seconds();
+    if ((m_flush_records && m_n_records >= m_flush_records) ||
+        (m_flush_ms && (now - m_lastflush_time) * 1e3 >= m_flush_ms) ||
+        (m_flush_bytes && m_filebytes - m_lastflush_bytes >= m_flush_bytes)) {
+      Flush();
+    } else if (m_bufsize && m_committed >= m_bufsize) {
+      WriteBuffer(m_committed);
+    }
+  }
+
   void FileSerializer::Flush() {
+    Time start = Time::Current();
+    // the uncommitted tail (a record still being serialized) stays in the buffer
+    WriteBuffer(m_committed);
     fflush(m_file);
+    Time stop = Time::Current();
+    double us = (stop - start).Seconds() * 1e6;
+    size_t bin = 0;
+    while (us >= 1 && bin < m_flush_hist.size() - 1) {
+      us /= 2;
+      ++bin;
+    }
+    ++m_flush_hist[bin];
+    m_n_records = 0;
+    m_lastflush_bytes = m_filebytes;
+    m_lastflush_time = stop.Seconds();
+  }
+
+  std::string FileSerializer::FlushStats() const {
+    std::string result = "Flush latencies:";
+    for (size_t i = 0; i < m_flush_hist.size(); ++i) {
+      if (m_flush_hist[i])
+        result += " <" + to_string(1u << i) + "us: " + to_string(m_flush_hist[i]);
+    }
+    return result;
   }
 
-  FileDeserializer::FileDeserializer(const std::string & fname, bool faileof, size_t buffersize) :
+  /** A read-only mapping of a complete file, shared with the events referencing it. */
+  struct FileDeserializer::MappedFile {
+    MappedFile(FILE * file, size_t size) : data(0), size(size) {
+#ifndef WIN32
+      void * ptr = mmap(0, size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+      if (ptr == MAP_FAILED) return;
+      data = static_cast<unsigned char *>(ptr);
+      madvise(ptr, size, MADV_SEQUENTIAL);
+      madvise(ptr, size, MADV_WILLNEED);
+#endif
+    }
+    ~MappedFile() {
+#ifndef WIN32
+      if (data) munmap(data, size);
+#endif
+    }
+    unsigned char * data;
+    size_t size;
+  };
+
+  FileDeserializer::FileDeserializer(const std::string & fname, bool faileof, size_t buffersize, bool mapped) :
     m_file(0), m_faileof(faileof), m_buf(buffersize), m_start(&m_buf[0]), m_stop(m_start)
   {
     m_file = fopen(fname.c_str(), "rb");
@@ -52,6 +151,18 @@ namespace eudaq {
     if (fseek(m_file, 0L, SEEK_END) != 0) {
         EUDAQ_THROWX(FileReadException, "seek to end failed: " + fname);
     }
+    if (mapped) {
+      long size = ftell(m_file);
+      if (size > 0) {
+        std::shared_ptr<MappedFile> map = std::make_shared<MappedFile>(m_file, size_t(size));
+        if (map->data) {
+          m_map = map;
+          m_start = m_map->data;
+          m_stop = m_start + m_map->size;
+        }
+      }
+      if (!m_map) EUDAQ_WARN("Unable to memory-map " + fname + ", reading it through a buffer");
+    }
     // go back to the beginning of the file
     if (fseek(m_file, 0L, SEEK_SET) != 0) {
         EUDAQ_THROWX(FileReadException, "seek to begin failed: " + fname);
@@ -59,12 +170,47 @@ namespace eudaq {
 
   }
 
+  FileDeserializer::~FileDeserializer() {
+    // events may still reference the mapping, it's released together with the last of them
+    if (m_file) fclose(m_file);
+  }
+
+  const unsigned char * FileDeserializer::View(size_t len, std::shared_ptr<const void> & source) {
+    if (!m_map || len > level()) return 0;
+    const unsigned char * result = m_start;
+    m_start += len;
+    source = m_map;
+    return result;
+  }
+
+  uint64_t FileDeserializer::Tell() {
+    if (m_map) return m_start - m_map->data;
+    return ftell(m_file) - level();
+  }
+
+  void FileDeserializer::Seek(uint64_t offset) {
+    if (m_map) {
+      if (offset > m_map->size) EUDAQ_THROWX(FileReadException, "seek beyond end of file");
+      m_start = m_map->data + offset;
+      return;
+    }
+    if (fseek(m_file, long(offset), SEEK_SET) != 0) {
+      EUDAQ_THROWX(FileReadException, "seek to " + to_string(offset) + " failed");
+    }
+    m_start = m_stop = &m_buf[0];
+  }
+
   bool FileDeserializer::HasData() {
     if (level() == 0) FillBuffer();
     return level() > 0;
   }
 
   size_t FileDeserializer::FillBuffer(size_t min) {
+    if (m_map) {
+      // everything is mapped already, there is nothing more to come
+      if (min > level()) throw FileReadException("End of File encountered");
+      return 0;
+    }
     clearerr(m_file);
     if (level() == 0) m_start = m_stop = &m_buf[0];
     unsigned char * end = &m_buf[0] + m_buf.size();
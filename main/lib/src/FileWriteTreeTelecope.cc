@@ -96,9 +96,11 @@ namespace eudaq {
     //tu
     std::vector<uint64_t> * v_scaler;
     std::vector<uint64_t> * old_scaler;
-    void SetTimeStamp(StandardEvent /*sev*/);
-    void SetBeamCurrent(StandardEvent /*sev*/);
-    void SetScalers(StandardEvent /*sev*/);
+    void SetTimeStamp(const StandardEvent &);
+    void SetBeamCurrent(const StandardEvent &);
+    void SetScalers(const StandardEvent &);
+    /** appends the hits of a plane to the vector branches, ind has to be the plane index in the tree */
+    void FillPixels(const StandardPlane::CompactPixels & pixels, uint8_t ind);
   };
 
   namespace {
@@ -216,15 +218,8 @@ namespace eudaq {
 
       const eudaq::StandardPlane & plane = sev.GetPlane(iplane);
       if(plane.Sensor() == "DUT") {
-        std::vector<double> cds = plane.GetPixels<double>();
         f_trig_phase->at(0) = int16_t(plane.GetTrigPhase());
-        for (uint16_t ipix = 0; ipix < cds.size(); ++ipix) {
-          f_plane->push_back(ind); // has to be ind and not iplane, so that the DUT are always first and REF after
-          f_col->push_back(uint16_t(plane.GetX(ipix)));
-          f_row->push_back(uint16_t(plane.GetY(ipix)));
-          f_adc->push_back(int16_t(plane.GetPixel(ipix)));
-          f_charge->push_back(42);                        // todo: do charge conversion here!
-        }
+        FillPixels(plane.Compact(), ind);
         ind++;
       }
     }
@@ -232,21 +227,24 @@ namespace eudaq {
 
       const eudaq::StandardPlane & plane = sev.GetPlane(iplane);
       if(plane.Sensor() != "DUT") {
-        std::vector<double> cds = plane.GetPixels<double>();
         f_trig_phase->at(1) = int16_t(plane.GetTrigPhase());
-        for (uint16_t ipix = 0; ipix < cds.size(); ++ipix) {
-          f_plane->push_back(ind); // has to be ind and not iplane, so that the DUT are always first and REF after
-          f_col->push_back(uint16_t(plane.GetX(ipix)));
-          f_row->push_back(uint16_t(plane.GetY(ipix)));
-          f_adc->push_back(int16_t(plane.GetPixel(ipix)));
-          f_charge->push_back(42);                        // todo: do charge conversion here!
-        }
+        FillPixels(plane.Compact(), ind);
         ind++;
       }
     }
     m_ttree->Fill();
 
   }
+
+  void FileWriterTreeTelescope::FillPixels(const StandardPlane::CompactPixels & pixels, uint8_t ind) {
+    f_plane->insert(f_plane->end(), pixels.size(), ind);
+    f_col->insert(f_col->end(), pixels.x.begin(), pixels.x.end());
+    f_row->insert(f_row->end(), pixels.y.begin(), pixels.y.end());
+    for (size_t ipix = 0; ipix < pixels.size(); ++ipix)
+      f_adc->push_back(int16_t(pixels.pix[ipix]));
+    f_charge->insert(f_charge->end(), pixels.size(), 42);   // todo: do charge conversion here!
+  }
+
   // Get max event number: DA
   long FileWriterTreeTelescope::GetMaxEventNumber(){
     return max_event_number;
@@ -265,7 +263,7 @@ namespace eudaq {
 
   uint64_t FileWriterTreeTelescope::FileBytes() const { return 0; }
 
-}void FileWriterTreeTelescope::SetTimeStamp(StandardEvent sev) {
+}void FileWriterTreeTelescope::SetTimeStamp(const StandardEvent & sev) {
   if (sev.hasTUEvent()){
     if (sev.GetTUEvent(0).GetValid()) { f_time = sev.GetTimestamp(); }
   }
@@ -273,18 +271,18 @@ namespace eudaq {
     f_time = sev.GetTimestamp() / 384066.;
 }
 
-void FileWriterTreeTelescope::SetBeamCurrent(StandardEvent sev) {
+void FileWriterTreeTelescope::SetBeamCurrent(const StandardEvent & sev) {
 
   if (sev.hasTUEvent()){
-    StandardTUEvent tuev = sev.GetTUEvent(0);
+    const StandardTUEvent & tuev = sev.GetTUEvent(0);
     f_beam_current = uint16_t(tuev.GetValid() ? tuev.GetBeamCurrent() : UINT16_MAX);
   }
 }
 
-void FileWriterTreeTelescope::SetScalers(StandardEvent sev) {
+void FileWriterTreeTelescope::SetScalers(const StandardEvent & sev) {
 
     if (sev.hasTUEvent()) {
-        StandardTUEvent tuev = sev.GetTUEvent(0);
+        const StandardTUEvent & tuev = sev.GetTUEvent(0);
         bool valid = tuev.GetValid();
         /** scaler continuously count upwards: subtract old scaler value and divide by time interval to get rate
          *  first scaler value is the scintillator and then the planes */
@@ -1,38 +1,57 @@
 #include "eudaq/FileNamer.hh"
 #include "eudaq/FileWriter.hh"
 #include "eudaq/FileSerializer.hh"
-//#include "eudaq/Logger.hh"
+#include "eudaq/Logger.hh"
 
 namespace eudaq {
 
   class FileWriterNative : public FileWriter {
     public:
       FileWriterNative(const std::string &);
+      virtual void Configure();
       virtual void StartRun(unsigned);
       virtual void WriteEvent(const DetectorEvent &);
       virtual uint64_t FileBytes() const;
       virtual ~FileWriterNative();
     private:
       FileSerializer * m_ser;
+      size_t m_buffersize, m_flush_events;
+      unsigned m_flush_ms;
+      uint64_t m_flush_bytes;
   };
 
   namespace {
     static RegisterFileWriter<FileWriterNative> reg("native");
   }
 
-  FileWriterNative::FileWriterNative(const std::string & /*param*/) : m_ser(0) {
+  FileWriterNative::FileWriterNative(const std::string & /*param*/)
+    : m_ser(0), m_buffersize(0), m_flush_events(1), m_flush_ms(0), m_flush_bytes(0) {
     //EUDAQ_DEBUG("Constructing FileWriterNative(" + to_string(param) + ")");
   }
 
+  void FileWriterNative::Configure() {
+    if (!m_config) return;
+    // group commit: flush every N events, T ms or M bytes, always at the EORE
+    m_buffersize = m_config->Get("WriteBufferSize", 0);
+    m_flush_events = m_config->Get("FlushEvents", 1);
+    m_flush_ms = m_config->Get("FlushMilliseconds", 0);
+    m_flush_bytes = m_config->Get("FlushBytes", uint64_t(0));
+  }
+
   void FileWriterNative::StartRun(unsigned runnumber) {
     delete m_ser;
-    m_ser = new FileSerializer(FileNamer(m_filepattern).Set('X', ".raw").Set('R', runnumber));
+    m_ser = new FileSerializer(FileNamer(m_filepattern).Set('X', ".raw").Set('R', runnumber), false, m_buffersize);
+    m_ser->SetFlushPolicy(m_flush_events, m_flush_ms, m_flush_bytes);
   }
 
   void FileWriterNative::WriteEvent(const DetectorEvent & ev) {
     if (!m_ser) EUDAQ_THROW("FileWriterNative: Attempt to write unopened file");
     m_ser->write(ev);
-    m_ser->Flush();
+    m_ser->Commit();
+    if (ev.IsEORE()) {
+      m_ser->Flush();
+      EUDAQ_INFO(m_ser->FlushStats());
+    }
   }
 
   FileWriterNative::~FileWriterNative() {
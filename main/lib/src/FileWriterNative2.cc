@@ -3,12 +3,14 @@
 #include "eudaq/FileSerializer.hh"
 #include "eudaq/BufferSerializer.hh"
 #include "eudaq/Event.hh"
+#include "eudaq/Logger.hh"
 
 namespace eudaq {
 
   class FileWriterNative2 : public FileWriter {
     public:
       FileWriterNative2(const std::string &);
+      virtual void Configure();
       virtual void StartRun(unsigned);
       virtual void WriteEvent(const DetectorEvent &);
       virtual uint64_t FileBytes() const;
@@ -16,21 +18,36 @@ namespace eudaq {
     private:
       BufferSerializer m_buf;
       FileSerializer * m_ser;
+      size_t m_buffersize, m_flush_events;
+      unsigned m_flush_ms;
+      uint64_t m_flush_bytes;
   };
 
   namespace {
     static RegisterFileWriter<FileWriterNative2> reg("native2");
   }
 
-  FileWriterNative2::FileWriterNative2(const std::string & /*param*/) : m_ser(0) {
+  FileWriterNative2::FileWriterNative2(const std::string & /*param*/)
+    : m_ser(0), m_buffersize(0), m_flush_events(1), m_flush_ms(0), m_flush_bytes(0) {
     //EUDAQ_DEBUG("Constructing FileWriterNative(" + to_string(param) + ")");
   }
 
+  void FileWriterNative2::Configure() {
+    if (!m_config) return;
+    // group commit: flush every N events, T ms or M bytes, always at the EORE
+    m_buffersize = m_config->Get("WriteBufferSize", 0);
+    m_flush_events = m_config->Get("FlushEvents", 1);
+    m_flush_ms = m_config->Get("FlushMilliseconds", 0);
+    m_flush_bytes = m_config->Get("FlushBytes", uint64_t(0));
+  }
+
   void FileWriterNative2::StartRun(unsigned runnumber) {
     delete m_ser;
-    m_ser = new FileSerializer(FileNamer(m_filepattern).Set('X', ".raw").Set('R', runnumber));
+    m_ser = new FileSerializer(FileNamer(m_filepattern).Set('X', ".raw").Set('R', runnumber), false, m_buffersize);
+    m_ser->SetFlushPolicy(m_flush_events, m_flush_ms, m_flush_bytes);
     unsigned versiontag = Event::str2id("VER2");
     m_ser->write(versiontag);
+    m_ser->Commit();
   }
 
   void FileWriterNative2::WriteEvent(const DetectorEvent & ev) {
@@ -38,7 +55,11 @@ namespace eudaq {
     m_buf.clear();
     m_buf.write(ev);
     m_ser->write(m_buf);
-    m_ser->Flush();
+    m_ser->Commit();
+    if (ev.IsEORE()) {
+      m_ser->Flush();
+      EUDAQ_INFO(m_ser->FlushStats());
+    }
   }
 
   FileWriterNative2::~FileWriterNative2() {
@@ -485,16 +485,13 @@ void FileWriterTreeCAEN::WriteEvent(const DetectorEvent & ev) {
     // ---------- save all info for the telescope -------------------------
     // --------------------------------------------------------------------
     for (uint8_t iplane = 0; iplane < sev.NumPlanes(); ++iplane) {
-        const eudaq::StandardPlane & plane = sev.GetPlane(iplane);
-        std::vector<double> cds = plane.GetPixels<double>();
-
-        for (uint16_t ipix = 0; ipix < cds.size(); ++ipix) {
-            f_plane->emplace_back(iplane);
-            f_col->push_back(uint16_t(plane.GetX(ipix)));
-            f_row->push_back(uint16_t(plane.GetY(ipix)));
-            f_adc->push_back(int16_t(plane.GetPixel(ipix)));
-            f_charge->push_back(42);						// todo: do charge conversion here!
-        }
+        const eudaq::StandardPlane::CompactPixels & pixels = sev.GetPlane(iplane).Compact();
+        f_plane->insert(f_plane->end(), pixels.size(), iplane);
+        f_col->insert(f_col->end(), pixels.x.begin(), pixels.x.end());
+        f_row->insert(f_row->end(), pixels.y.begin(), pixels.y.end());
+        for (size_t ipix = 0; ipix < pixels.size(); ++ipix)
+            f_adc->push_back(int16_t(pixels.pix[ipix]));
+        f_charge->insert(f_charge->end(), pixels.size(), 42);	// todo: do charge conversion here!
     }
     m_ttree->Fill();
     if (f_event_number + 1 % 1000 == 0) cout << "of run " << runnumber << flush;
@@ -740,6 +737,8 @@ void FileWriterTreeCAEN::FillRegionIntegrals(uint8_t iwf, const StandardWaveform
     if (regions->count(iwf) == 0) return;
     WaveformSignalRegions * this_regions = (*regions)[iwf];
     uint16_t nRegions = this_regions->GetNRegions();
+    const vector<float> & times = wf->GetTimes();
+    sums.Build(wf->GetData()->data(), wf->GetData()->size(), times.empty() ? 0 : times.data());
     for (uint16_t i=0; i < nRegions; i++){
         if (verbose > 0) cout << "REGION LOOP" << endl;
         WaveformSignalRegion * region = this_regions->GetRegion(i);
@@ -768,11 +767,11 @@ void FileWriterTreeCAEN::FillRegionIntegrals(uint8_t iwf, const StandardWaveform
                 integral = wf->getMedian(low_border,high_border);
             }
             else if (name.find("full")!=name.npos){
-                integral = wf->getIntegral(low_border,high_border);
+                integral = sums.Integral(low_border,high_border);
             }
             else {
-                integral = wf->getIntegral(p->GetIntegralStart(), p->GetIntegralStop());
-                time_integral = wf->getIntegral(p->GetIntegralStart(), p->GetIntegralStop(), peak_pos, 2.5);
+                integral = sums.Integral(p->GetIntegralStart(), p->GetIntegralStop());
+                time_integral = sums.TimeIntegral(p->GetIntegralStart(), p->GetIntegralStop(), peak_pos, 2.5);
             }
             p->SetIntegral(integral);
             p->SetTimeIntegral(time_integral);
@@ -832,11 +831,11 @@ void FileWriterTreeCAEN::FillTotalRange(uint8_t iwf, const StandardWaveform *wf)
         v_max_peak_position->at(iwf) = peak.first;
         v_max_peak_time->at(iwf) = getTriggerTime(iwf, peak.first);
         float threshold = polarities.at(iwf) * 4 * noise->at(iwf).second + noise->at(iwf).first;
-        vector<uint16_t> * peak_positions = wf->getAllPeaksAbove(0, 1023, threshold);
-        v_peak_positions->at(iwf) = *peak_positions;
-        v_npeaks->at(iwf) = uint8_t(v_peak_positions->at(iwf).size());
+        vector<uint16_t> & peak_positions = v_peak_positions->at(iwf);
+        wf->getAllPeaksAbove(0, 1023, threshold, peak_positions);
+        v_npeaks->at(iwf) = uint8_t(peak_positions.size());
         vector<float> peak_timings;
-        for (auto i_pos:*peak_positions) peak_timings.push_back(getTriggerTime(iwf, i_pos));
+        for (auto i_pos:peak_positions) peak_timings.push_back(getTriggerTime(iwf, i_pos));
         v_peak_times->at(iwf) = peak_timings;
     }
 
@@ -921,7 +920,7 @@ string FileWriterTreeCAEN::GetPolarities(vector<signed char> pol) {
     return trim(ss.str(), " ");
 }
 
-void FileWriterTreeCAEN::SetTimeStamp(StandardEvent sev) {
+void FileWriterTreeCAEN::SetTimeStamp(const StandardEvent & sev) {
     if (sev.hasTUEvent()){
         if (sev.GetTUEvent(0).GetValid())
             f_time = sev.GetTimestamp();
@@ -930,10 +929,10 @@ void FileWriterTreeCAEN::SetTimeStamp(StandardEvent sev) {
         f_time = sev.GetTimestamp() / 384066.;
 }
 
-void FileWriterTreeCAEN::SetBeamCurrent(StandardEvent sev) {
+void FileWriterTreeCAEN::SetBeamCurrent(const StandardEvent & sev) {
 
   if (sev.hasTUEvent()){
-    StandardTUEvent tuev = sev.GetTUEvent(0);
+    const StandardTUEvent & tuev = sev.GetTUEvent(0);
     f_beam_current = uint16_t(tuev.GetValid() ? tuev.GetBeamCurrent() : UINT16_MAX);
   }
 }
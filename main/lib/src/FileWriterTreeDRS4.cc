@@ -12,7 +12,8 @@ namespace { static RegisterFileWriter<FileWriterTreeDRS4> reg("drs4tree"); }
     --------------------------CONSTRUCTOR--------------------------------
     =====================================================================*/
 FileWriterTreeDRS4::FileWriterTreeDRS4(const std::string & /*param*/)
-: m_tfile(0), m_ttree(0), m_noe(0), n_channels(4), n_active_channels(0), n_pixels(90*90+60*60), histo(0), spec(0), fft_own(0), runnumber(0), hasTU(false), rise_time(5) {
+: m_tfile(0), m_ttree(0), m_noe(0), n_channels(4), n_active_channels(0), n_pixels(90*90+60*60), histo(0), runnumber(0), hasTU(false), rise_time(5),
+  fast_fit_waveforms(0), gauss_fit_waveforms(0), fft_save_values(0), fft_n_modes(10), n_threads(1), max_queued_events(0), m_stop(false), m_time(-1.), m_beam_current(UINT16_MAX), m_n_dispatched(0), m_n_committed(0), m_last_event_number(-1) {
 
     gROOT->ProcessLine("gErrorIgnoreLevel = 5001;");
     gROOT->ProcessLine("#include <vector>");
@@ -80,14 +81,17 @@ FileWriterTreeDRS4::FileWriterTreeDRS4(const std::string & /*param*/)
     noise = new vector<pair<float, float> >;
     noise->resize(4);
     for (uint8_t i = 0; i < 4; i++) noise_vectors[i] = new deque<float>;
-    decon.resize(1024, 0);
-    peaks_x.resize(4, new std::vector<uint16_t>);
-    peaks_x_time.resize(4, new std::vector<float>);
-    peaks_y.resize(4, new std::vector<float>);
+    for (uint8_t i = 0; i < 4; i++) {
+        peaks_x.push_back(new std::vector<uint16_t>);
+        peaks_x_time.push_back(new std::vector<float>);
+        peaks_y.push_back(new std::vector<float>);
+    }
 
     // fft analysis
-    fft_modes.resize(4, new std::vector<float>);
-    fft_values.resize(4, new std::vector<float>);
+    for (uint8_t i = 0; i < 4; i++) {
+        fft_modes.push_back(new std::vector<float>);
+        fft_values.push_back(new std::vector<float>);
+    }
     fft_mean = new std::vector<float>;
     fft_mean_freq = new std::vector<float>;
     fft_max = new std::vector<float>;
@@ -118,19 +122,103 @@ FileWriterTreeDRS4::FileWriterTreeDRS4(const std::string & /*param*/)
     avgWF_3_pul = new TH1F("avgWF_3_pul","avgWF_3_pul", 1024, 0, 1024);
     avgWF_3_sig = new TH1F("avgWF_3_sig","avgWF_3_sig", 1024, 0, 1024);
 
-    spec = new TSpectrum(25);
-    fft_own = 0;
-    if(!fft_own){
-        int n = 1024;
-        n_samples = n + 1;
-//        cout << "Creating a new VirtualFFT with " << n_samples << " Samples" << endl;
-        re_full = new Double_t[n];
-        im_full = new Double_t[n];
-        in = new Double_t[n];
-        fft_own = TVirtualFFT::FFT(1, &n_samples, "R2C");
-    }
+    // the serial path always uses the first worker
+    m_workers.push_back(new Worker);
 } // end Constructor
 
+FileWriterTreeDRS4::Worker::Worker() : spec(new TSpectrum(25)) {
+    decon.resize(1024, 0);
+}
+
+FileWriterTreeDRS4::Worker::~Worker() {
+    delete spec;
+}
+
+FileWriterTreeDRS4::EventData::EventData() : index(0), event_number(-1), time(-1.), beam_current(UINT16_MAX), trigger_cell(0), pulser(-1),
+                                              n_peaks_total(0), n_peaks_before_roi(0), n_peaks_after_roi(0) {
+    scaler.resize(5);
+}
+
+void FileWriterTreeDRS4::EventData::Clear() {
+    /** the buffers are recycled, so every value which is not set by the analysis has to be reset */
+    error = nullptr;
+    pulser = -1;
+    cft.clear();
+    is_saturated.clear();
+    median.clear();
+    average.clear();
+    max_peak_position.clear();
+    max_peak_time.clear();
+    npeaks.clear();
+    rise_time.clear();
+    fall_time.clear();
+    wf_start.clear();
+    fit_peak_time.clear();
+    fit_peak_value.clear();
+    peaking_time.clear();
+    fft_mean.clear();
+    fft_mean_freq.clear();
+    fft_max.clear();
+    fft_max_freq.clear();
+    fft_min.clear();
+    fft_min_freq.clear();
+    forc_pos.clear();
+    forc_time.clear();
+    is_da.clear();
+    plane.clear();
+    col.clear();
+    row.clear();
+    adc.clear();
+    charge.clear();
+    integral_values.clear();
+    time_integral_values.clear();
+    integral_peaks.clear();
+    integral_peak_time.clear();
+    integral_length.clear();
+    n_peaks_total = 0;
+    n_peaks_before_roi = 0;
+    n_peaks_after_roi = 0;
+}
+
+void FileWriterTreeDRS4::EventData::Resize(size_t n_channels) {
+    is_saturated.resize(n_channels);
+    median.resize(n_channels);
+    average.resize(n_channels);
+    max_peak_time.resize(n_channels, 0);
+    max_peak_position.resize(n_channels, 0);
+    peak_positions.resize(n_channels);
+    peak_times.resize(n_channels);
+    npeaks.resize(n_channels, 0);
+    rise_time.resize(n_channels);
+    fall_time.resize(n_channels);
+    wf_start.resize(n_channels);
+    fit_peak_time.resize(n_channels);
+    fit_peak_value.resize(n_channels);
+    peaking_time.resize(n_channels);
+    is_da.resize(n_channels);
+    cft.resize(n_channels);
+
+    fft_mean.resize(n_channels, 0);
+    fft_min.resize(n_channels, 0);
+    fft_max.resize(n_channels, 0);
+    fft_mean_freq.resize(n_channels, 0);
+    fft_min_freq.resize(n_channels, 0);
+    fft_max_freq.resize(n_channels, 0);
+
+    peaks_x.resize(n_channels);
+    peaks_x_time.resize(n_channels);
+    peaks_y.resize(n_channels);
+    fft_values.resize(n_channels);
+    fft_modes.resize(n_channels);
+    for (auto & vec: peak_positions) vec.clear();
+    for (auto & vec: peak_times) vec.clear();
+    for (auto & peak: peaks_x) peak.clear();
+    for (auto & peak: peaks_x_time) peak.clear();
+    for (auto & peak: peaks_y) peak.clear();
+    for (auto & vec: fft_values) vec.clear();
+    for (auto & vec: fft_modes) vec.clear();
+}
+
 /** =====================================================================
     --------------------------CONFIGURE----------------------------------
     =====================================================================*/
@@ -161,6 +249,9 @@ void FileWriterTreeDRS4::Configure(){
     spec_rm_bg = m_config->Get("spectrum_background_removal", true);
     spectrum_waveforms = m_config->Get("spectrum_waveforms", uint16_t(0));
     fft_waveforms = m_config->Get("fft_waveforms", uint16_t(0));
+    fft_save_values = m_config->Get("fft_save_values", fft_waveforms);
+    fft_n_modes = m_config->Get("fft_n_modes", 10);
+    WaveformFFT::SetWisdomFile(m_config->Get("fft_wisdom", ""));
 
     //peak finding
     peak_finding_roi = m_config->Get("peak_finding_roi", make_pair(0.0, 0.0));
@@ -173,6 +264,14 @@ void FileWriterTreeDRS4::Configure(){
     // saved waveforms
     save_waveforms = m_config->Get("save_waveforms", uint16_t(9));
 
+    // peak and leading edge estimators, the channels in neither bitmask use the Minuit fits
+    gauss_fit_waveforms = m_config->Get("gauss_fit_waveforms", uint16_t(0));
+    fast_fit_waveforms = m_config->Get("fast_fit_waveforms", uint16_t(0)) | gauss_fit_waveforms;
+
+    // event pipeline: 1 analyses the events in the calling thread
+    n_threads = max(m_config->Get("n_threads", uint16_t(1)), uint16_t(1));
+    max_queued_events = size_t(m_config->Get("max_queued_events", 4 * n_threads));
+
     // polarities
     polarities = m_config->Get("polarities", polarities);
     pulser_polarities = m_config->Get("pulser_polarities", pulser_polarities);
@@ -187,8 +286,13 @@ void FileWriterTreeDRS4::Configure(){
     macro->AddLine((append_spaces(21, "pulser threshold = ") + to_string(pulser_threshold)).c_str());
     macro->AddLine((append_spaces(21, "active regions = ") + to_string(GetBitMask(active_regions))).c_str());
     macro->AddLine((append_spaces(21, "save waveforms = ") + GetBitMask(save_waveforms)).c_str());
+    macro->AddLine((append_spaces(21, "threads = ") + to_string(n_threads)).c_str());
     macro->AddLine((append_spaces(21, "fft waveforms = ") + GetBitMask(fft_waveforms)).c_str());
+    macro->AddLine((append_spaces(21, "fft save values = ") + GetBitMask(fft_save_values)).c_str());
+    macro->AddLine((append_spaces(21, "fft n modes = ") + to_string(fft_n_modes)).c_str());
     macro->AddLine((append_spaces(21, "spectrum waveforms = ") + GetBitMask(spectrum_waveforms)).c_str());
+    macro->AddLine((append_spaces(21, "fast fit waveforms = ") + GetBitMask(fast_fit_waveforms)).c_str());
+    macro->AddLine((append_spaces(21, "gauss fit waveforms = ") + GetBitMask(gauss_fit_waveforms)).c_str());
     macro->AddLine((append_spaces(20, "polarities = ") + GetPolarities(polarities)).c_str());
     macro->AddLine((append_spaces(20, "pulser polarities = ") + GetPolarities(pulser_polarities)).c_str());
     macro->AddLine((append_spaces(20, "spectrum_polarities = ") + GetPolarities(spectrum_polarities)).c_str());
@@ -208,6 +312,7 @@ void FileWriterTreeDRS4::Configure(){
 
     // read the region where we want to find the peak from the config file
     ReadIntegralRegions();
+    CompileIntegralPlan();
     for (auto ch: *regions) {
       macro->AddLine(TString::Format("\n[Integral Regions %d]", ch.first));
       for (auto region: ch.second->GetRegions())
@@ -223,6 +328,7 @@ void FileWriterTreeDRS4::Configure(){
         for (auto integral: region->GetIntegrals())
           names.push_back(TString::Format("\"ch%d_%s_%s\"", int(ch.first), region->GetName(), integral->GetName().c_str()));
     macro->AddLine(("Names = [" + to_string(names) + "]").c_str());
+    InitWorkers();
 
     cout << "\nMAXIMUM NUMBER OF EVENTS: " << (max_event_number ? to_string(max_event_number) : "ALL") << endl;
     EUDAQ_INFO("End of Configure!");
@@ -314,7 +420,8 @@ void FileWriterTreeDRS4::StartRun(unsigned runnumber) {
         }
         if (UseWaveForm(fft_waveforms, i_wf)) {
             m_ttree->Branch(TString::Format("fft_modes%d", i_wf), &fft_modes.at(i_wf));
-            m_ttree->Branch(TString::Format("fft_values%d", i_wf), &fft_values.at(i_wf));
+            if (UseWaveForm(fft_save_values, i_wf))
+                m_ttree->Branch(TString::Format("fft_values%d", i_wf), &fft_values.at(i_wf));
         }
     }
 
@@ -327,6 +434,7 @@ void FileWriterTreeDRS4::StartRun(unsigned runnumber) {
     verbose = 1;
     
     EUDAQ_INFO("Done with creating Branches!");
+    StartThreads();
 }
 
 /** =====================================================================
@@ -345,44 +453,184 @@ void FileWriterTreeDRS4::WriteEvent(const DetectorEvent & ev) {
         return;
     }
     else if (ev.IsEORE()) {
+        Drain();
+        RethrowError();
         eudaq::PluginManager::ConvertToStandard(ev);
         cout << "loading the last event...." << endl;
         return;
     }
-    if (max_event_number > 0 && f_event_number > max_event_number) return;
+    if (max_event_number > 0 && m_last_event_number > max_event_number) return;
+    RethrowError();
 
     w_total.Start(false);
-    StandardEvent sev = eudaq::PluginManager::ConvertToStandard(ev);
+    EventData * event = GetFreeEvent();
+    event->sev = eudaq::PluginManager::ConvertToStandard(ev);
+    PrepareEvent(*event);
+
+    if (n_threads == 1) {
+        AnalyseEvent(*event, *m_workers.at(0));
+        CommitEvent(*event);
+        m_free_events.push_back(event);
+        m_n_committed++;
+    } else {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_pending.push_back(event);
+        m_cv_pending.notify_one();
+    }
+    w_total.Stop();
+} // end WriteEvent()
+
+/** =====================================================================
+    -------------------------EVENT PIPELINE------------------------------
+    =====================================================================*/
+void FileWriterTreeDRS4::InitWorkers() {
+
+    /** every worker needs its own TSpectrum and FFT, since they keep the per-event results.
+     *  ROOT objects are created here in the main thread, the workers only use them. */
+    while (m_workers.size() < n_threads) m_workers.push_back(new Worker);
+    if (n_threads > 1) {
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,0,0)
+        ROOT::EnableThreadSafety();
+#else
+        TThread::Initialize();
+#endif
+        EUDAQ_INFO("Analysing the waveforms in " + to_string(n_threads) + " threads");
+    }
+}
 
-    f_event_number = sev.GetEventNumber();
+void FileWriterTreeDRS4::StartThreads() {
+
+    if (n_threads == 1 or m_writer_thread.joinable()) return;
+    m_stop = false;
+    for (auto w: m_workers) w->thread = std::thread(&FileWriterTreeDRS4::WorkerLoop, this, w);
+    m_writer_thread = std::thread(&FileWriterTreeDRS4::WriterLoop, this);
+}
+
+void FileWriterTreeDRS4::StopThreads() {
+
+    if (not m_writer_thread.joinable()) return;
+    Drain();
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv_pending.notify_all();
+    m_cv_analysed.notify_all();
+    for (auto w: m_workers) if (w->thread.joinable()) w->thread.join();
+    m_writer_thread.join();
+}
+
+void FileWriterTreeDRS4::Drain() {
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv_committed.wait(lock, [this] { return m_n_committed == m_n_dispatched; });
+}
+
+void FileWriterTreeDRS4::RethrowError() {
+
+    /** exceptions of the worker threads are thrown again in the thread calling WriteEvent */
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_error) std::rethrow_exception(m_error);
+}
+
+FileWriterTreeDRS4::EventData * FileWriterTreeDRS4::GetFreeEvent() {
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // limit the number of events in flight, otherwise a slow writer lets the queue grow without bound
+    m_cv_committed.wait(lock, [this] { return n_threads == 1 or m_n_dispatched - m_n_committed < max_queued_events; });
+    EventData * event;
+    if (m_free_events.empty())
+        event = new EventData;
+    else {
+        event = m_free_events.back();
+        m_free_events.pop_back();
+    }
+    event->index = m_n_dispatched++;
+    return event;
+}
+
+void FileWriterTreeDRS4::WorkerLoop(Worker * w) {
+
+    while (true) {
+        EventData * event;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv_pending.wait(lock, [this] { return m_stop or not m_pending.empty(); });
+            if (m_pending.empty()) return;
+            event = m_pending.front();
+            m_pending.pop_front();
+        }
+        try {
+            AnalyseEvent(*event, *w);
+        } catch (...) {
+            event->error = std::current_exception();
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_analysed[event->index] = event;
+        m_cv_analysed.notify_one();
+    }
+}
+
+void FileWriterTreeDRS4::WriterLoop() {
+
+    /** the events are analysed in any order, but they are filled into the tree in the order they were read */
+    while (true) {
+        EventData * event;
+        bool failed;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv_analysed.wait(lock, [this] { return m_stop or m_analysed.count(m_n_committed); });
+            if (not m_analysed.count(m_n_committed)) return;
+            event = m_analysed.at(m_n_committed);
+            m_analysed.erase(m_n_committed);
+            if (event->error and not m_error) m_error = event->error;
+            failed = bool(m_error);
+        }
+        /** like the serial path, which stops at the exception, no row is written from the failed event on */
+        if (not failed) CommitEvent(*event);
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_free_events.push_back(event);
+        m_n_committed++;
+        m_cv_committed.notify_all();
+    }
+}
+
+void FileWriterTreeDRS4::PrepareEvent(EventData & event) {
+
+    /** everything which depends on the previous events has to be done here in the reading order */
+    event.Clear();
+    StandardEvent & sev = event.sev;
+    event.event_number = sev.GetEventNumber();
+    m_last_event_number = event.event_number;
 
     /** TU STUFF */
-    SetTimeStamp(sev);
-    SetBeamCurrent(sev);
-    SetScalers(sev);
+    SetTimeStamp(event);
+    SetBeamCurrent(event);
+    SetScalers(event);
     // --------------------------------------------------------------------
     // ---------- get the number of waveforms -----------------------------
     // --------------------------------------------------------------------
     auto nwfs = (unsigned int) sev.NumWaveforms();
-    f_nwfs = nwfs;
 
-    if(f_event_number <= 10 && verbose > 0){
+    if(event.event_number <= 10 && verbose > 0){
         if(nwfs ==0){
             cout << "----------------------------------------" << endl;
             cout << "WARNING!!! NO WAVEFORMS IN THIS EVENT!!!" << endl;
             cout << "----------------------------------------" << endl;
         }
     }
+    if (verbose > 3) cout << "event number " << event.event_number << endl;
+    if (verbose > 3) cout << "number of waveforms " << nwfs << endl;
 
-    if (verbose > 3) cout << "ClearVectors" << endl;
-    ClearVectors();
+    event.Resize(nwfs);
+    vector<uint8_t> wf_order = {2, 1, 0, 3};
+    for (auto iwf : wf_order) calc_noise(iwf, *sev.GetWaveform(iwf).GetData());
+    event.noise = *noise;
+}
 
-    // --------------------------------------------------------------------
-    // ---------- verbosity level and some printouts ----------------------
-    // --------------------------------------------------------------------
+void FileWriterTreeDRS4::AnalyseEvent(EventData & event, Worker & w) {
 
-    if (verbose > 3) cout << "event number " << f_event_number << endl;
-    if (verbose > 3) cout << "number of waveforms " << nwfs << endl;
+    StandardEvent & sev = event.sev;
 
     // --------------------------------------------------------------------
     // ---------- get and save all info for all waveforms -----------------
@@ -390,93 +638,140 @@ void FileWriterTreeDRS4::WriteEvent(const DetectorEvent & ev) {
 
     //use different order of wfs in order to 'know' if its a pulser event or not.
     vector<uint8_t> wf_order = {2, 1, 0, 3};
+    // drs4 info
+    event.trigger_cell = sev.GetWaveform(wf_order.at(0)).GetTriggerCell(); // same for every waveform
     for (auto iwf : wf_order) {
       sev.GetWaveform(iwf).SetPolarities(polarities.at(iwf), pulser_polarities.at(iwf));
-      sev.GetWaveform(iwf).SetTimes(&tcal.at(0));
+      sev.GetWaveform(iwf).SetTimes(time_calibration.at(0).GetTimes(sev.GetWaveform(iwf).GetTriggerCell()));
     }
-    ResizeVectors(sev.GetNWaveforms());
-    FillRegionIntegrals(sev);
+    FillRegionIntegrals(event, w);
+    DoFFTAnalysis(event, w);
 
     for (auto iwf : wf_order){
         if (verbose > 3) cout<<"Channel Nr: "<< int(iwf) <<endl;
 
         const eudaq::StandardWaveform & waveform = sev.GetWaveform(iwf);
-        // save the sensor names
-        if (f_event_number == 0) {
-            sensor_name.resize(sev.GetNWaveforms(), "");
-            sensor_name.at(iwf) = waveform.GetChannelName();
-        }
-
-        int n_samples = waveform.GetNSamples();
-        if (verbose > 3) cout << "number of samples in my wf " << n_samples << std::endl;
         // load the waveforms into the vector
-        data = waveform.GetData();
-        calc_noise(iwf);
+        const vector<float> & data = *waveform.GetData();
 
-        this->FillSpectrumData(iwf);
+        this->FillSpectrumData(w, iwf, data);
         if (verbose > 3) cout<<"DoSpectrumFitting "<< iwf <<endl;
-        this->DoSpectrumFitting(iwf);
-        if (verbose > 3) cout << "DoFFT " << iwf << endl;
-        this->DoFFTAnalysis(iwf);
-
-        // drs4 info
-        if (iwf == wf_order.at(0)) f_trigger_cell = waveform.GetTriggerCell(); // same for every waveform
+        this->DoSpectrumFitting(event, w, iwf);
 
         // calculate the signal and so on
-
         if (verbose > 3) cout << "get Values1.1 " << iwf << endl;
-        FillTotalRange(iwf, &waveform);
+        FillTotalRange(event, w, iwf, &waveform);
 
         // determine FORC timing: trigger WF august: 2, may: 1
         if (verbose > 3) cout << "get trigger wf " << iwf << endl;
-        if (iwf == trigger_channel) ExtractForcTiming(data);
+        if (iwf == trigger_channel) ExtractForcTiming(event, data);
 
         // determine pulser events: pulser WF august: 1, may: 2
         if (verbose > 3) cout<<"get pulser wf "<<iwf<<endl;
-        if (iwf == pulser_channel){
-            f_pulser = this->IsPulserEvent(&waveform);
-            if (f_pulser) f_pulser_events++;
-            else f_signal_events++;
-        }
-
-        // fill waveform vectors
-        if (verbose > 3) cout << "fill wf " << iwf << endl;
-        UpdateWaveforms(iwf);
+        if (iwf == pulser_channel) event.pulser = this->IsPulserEvent(&waveform);
 
-        f_isDa->at(iwf) = *max_element(&data->at(20), &data->at(1023)) > wf_thr.at(iwf);
-
-        data->clear();
+        event.is_da.at(iwf) = *max_element(&data.at(20), &data.at(1023)) > wf_thr.at(iwf);
     } // end iwf waveform loop
 
-
-    FillRegionVectors();
-
     // --------------------------------------------------------------------
     // ---------- save all info for the telescope -------------------------
     // --------------------------------------------------------------------
     for (uint8_t iplane = 0; iplane < sev.NumPlanes(); ++iplane) {
-        const eudaq::StandardPlane & plane = sev.GetPlane(iplane);
-        std::vector<double> cds = plane.GetPixels<double>();
-
-        for (uint16_t ipix = 0; ipix < cds.size(); ++ipix) {
-            f_plane->emplace_back(iplane);
-            f_col->push_back(uint16_t(plane.GetX(ipix)));
-            f_row->push_back(uint16_t(plane.GetY(ipix)));
-            f_adc->push_back(int16_t(plane.GetPixel(ipix)));
-            f_charge->push_back(42);						// todo: do charge conversion here!
+        const eudaq::StandardPlane::CompactPixels & pixels = sev.GetPlane(iplane).Compact();
+        event.plane.insert(event.plane.end(), pixels.size(), iplane);
+        event.col.insert(event.col.end(), pixels.x.begin(), pixels.x.end());
+        event.row.insert(event.row.end(), pixels.y.begin(), pixels.y.end());
+        for (size_t ipix = 0; ipix < pixels.size(); ++ipix)
+            event.adc.push_back(int16_t(pixels.pix[ipix]));
+        event.charge.insert(event.charge.end(), pixels.size(), 42);	// todo: do charge conversion here!
+    }
+}
+
+void FileWriterTreeDRS4::CommitEvent(EventData & event) {
+
+    /** swap the results into the branch buffers, the event keeps the old buffers for reuse */
+    const StandardEvent & sev = event.sev;
+    f_event_number = event.event_number;
+    f_time = event.time;
+    f_beam_current = event.beam_current;
+    v_scaler->swap(event.scaler);
+    f_nwfs = sev.NumWaveforms();
+    f_trigger_cell = event.trigger_cell;
+    f_pulser = event.pulser;
+    if (f_pulser) f_pulser_events++;
+    else f_signal_events++;
+
+    v_forc_pos->swap(event.forc_pos);
+    v_forc_time->swap(event.forc_time);
+    IntegralValues->swap(event.integral_values);
+    TimeIntegralValues->swap(event.time_integral_values);
+    IntegralPeaks->swap(event.integral_peaks);
+    IntegralPeakTime->swap(event.integral_peak_time);
+    IntegralLength->swap(event.integral_length);
+    std::copy(event.cft.begin(), event.cft.begin() + min(event.cft.size(), size_t(n_channels)), v_cft);
+    v_is_saturated->swap(event.is_saturated);
+    f_isDa->swap(event.is_da);
+    v_median->swap(event.median);
+    v_average->swap(event.average);
+    v_max_peak_position->swap(event.max_peak_position);
+    v_max_peak_time->swap(event.max_peak_time);
+    v_peak_positions->swap(event.peak_positions);
+    v_peak_times->swap(event.peak_times);
+    v_npeaks->swap(event.npeaks);
+    v_rise_time->swap(event.rise_time);
+    v_fall_time->swap(event.fall_time);
+    v_wf_start->swap(event.wf_start);
+    v_fit_peak_time->swap(event.fit_peak_time);
+    v_fit_peak_value->swap(event.fit_peak_value);
+    v_peaking_time->swap(event.peaking_time);
+    n_peaks_total = event.n_peaks_total;
+    n_peaks_before_roi = event.n_peaks_before_roi;
+    n_peaks_after_roi = event.n_peaks_after_roi;
+    for (uint8_t iwf = 0; iwf < peaks_x.size() and iwf < event.peaks_x.size(); iwf++) {
+        peaks_x.at(iwf)->swap(event.peaks_x.at(iwf));
+        peaks_x_time.at(iwf)->swap(event.peaks_x_time.at(iwf));
+        peaks_y.at(iwf)->swap(event.peaks_y.at(iwf));
+        fft_values.at(iwf)->swap(event.fft_values.at(iwf));
+        fft_modes.at(iwf)->swap(event.fft_modes.at(iwf));
+    }
+    fft_mean->swap(event.fft_mean);
+    fft_mean_freq->swap(event.fft_mean_freq);
+    fft_max->swap(event.fft_max);
+    fft_max_freq->swap(event.fft_max_freq);
+    fft_min->swap(event.fft_min);
+    fft_min_freq->swap(event.fft_min_freq);
+    f_plane->swap(event.plane);
+    f_col->swap(event.col);
+    f_row->swap(event.row);
+    f_adc->swap(event.adc);
+    f_charge->swap(event.charge);
+
+    vector<uint8_t> wf_order = {2, 1, 0, 3};
+    for (auto v_wf: f_wf) v_wf.second->clear();
+    for (auto iwf : wf_order){
+        const eudaq::StandardWaveform & waveform = sev.GetWaveform(iwf);
+        // save the sensor names
+        if (f_event_number == 0) {
+            sensor_name.resize(sev.GetNWaveforms(), "");
+            sensor_name.at(iwf) = waveform.GetChannelName();
         }
+        if (UseWaveForm(fft_waveforms, iwf) and verbose > 0 and f_event_number < 1000)
+            cout << runnumber << " " << std::setw(3) << f_event_number << " " << iwf << " " << fft_mean->at(iwf) << " " << fft_max->at(iwf) << " " << fft_min->at(iwf) << endl;
+        // fill waveform vectors
+        if (verbose > 3) cout << "fill wf " << iwf << endl;
+        UpdateWaveforms(iwf, *waveform.GetData());
     }
     m_ttree->Fill();
     if (f_event_number + 1 % 1000 == 0) cout << "of run " << runnumber << flush;
 //        <<" "<<std::setw(7)<<f_event_number<<"\tSpectrum: "<<w_spectrum.RealTime()/w_spectrum.Counter()<<"\t" <<"LinearFitting: "
 //        <<w_linear_fitting.RealTime()/w_linear_fitting.Counter()<<"\t"<< w_spectrum.Counter()<<"/"<<w_linear_fitting.Counter()<<"\t"<<flush;
-    w_total.Stop();
-} // end WriteEvent()
+} // end CommitEvent()
 
 /** =====================================================================
     -------------------------DECONSTRUCTOR-------------------------------
     =====================================================================*/
 FileWriterTreeDRS4::~FileWriterTreeDRS4() {
+    StopThreads();
     if (macro && m_ttree) {
         macro->AddLine("\n[Sensor Names]");
         vector<string> names;
@@ -491,7 +786,9 @@ FileWriterTreeDRS4::~FileWriterTreeDRS4() {
         ss << "\nTotal time: " << setw(2) << setfill('0') << int(t / 60) << ":" << setw(2) << setfill('0')
            << int(t - int(t / 60) * 60);
         if (entries > 1000) ss << "\nTime/1000 events: " << int(t / entries * 1000 * 1000) << " ms";
-        if (spectrum_waveforms) ss << "\nTSpectrum: " << w_spectrum.RealTime() << " seconds";
+        double t_spectrum = 0;
+        for (auto w: m_workers) t_spectrum += w->w_spectrum.RealTime();
+        if (spectrum_waveforms) ss << "\nTSpectrum: " << t_spectrum << " seconds";
         print_banner(ss.str(), '*');
     }
         if(m_tfile)
@@ -510,6 +807,8 @@ FileWriterTreeDRS4::~FileWriterTreeDRS4() {
         avgWF_3_pul->Write();
     }
     if (macro) macro->Write();
+    for (auto w: m_workers) delete w;
+    for (auto event: m_free_events) delete event;
 }
 
 float FileWriterTreeDRS4::Calculate(std::vector<float> * data, int min, int max, bool _abs) {
@@ -555,179 +854,106 @@ float FileWriterTreeDRS4::avgWF(float old_avg, float new_value, int n) {
 
 uint64_t FileWriterTreeDRS4::FileBytes() const { return 0; }
 
-inline void FileWriterTreeDRS4::ClearVectors(){
-
-    v_is_saturated->clear();
-    v_median->clear();
-    v_average->clear();
-    v_forc_pos->clear();
-    v_forc_time->clear();
-
-    for (auto v_wf:f_wf) v_wf.second->clear();
-    f_isDa->clear();
-
-    f_plane->clear();
-    f_col->clear();
-    f_row->clear();
-    f_adc->clear();
-    f_charge->clear();
-
-    for (auto vec: *v_peak_positions) vec.clear();
-    for (auto vec: *v_peak_times) vec.clear();
-    for (auto peak: peaks_x) peak->clear();
-    for (auto peak: peaks_x_time) peak->clear();
-    for (auto peak: peaks_y) peak->clear();
-} // end ClearVectors()
-
-inline void FileWriterTreeDRS4::ResizeVectors(size_t n_channels) {
-    for (auto r: *regions) r.second->Reset();
-
-    v_is_saturated->resize(n_channels);
-    v_median->resize(n_channels);
-    v_average->resize(n_channels);
-    v_max_peak_time->resize(n_channels, 0);
-    v_max_peak_position->resize(n_channels, 0);
-    v_rise_time->resize(n_channels);
-    v_fall_time->resize(n_channels);
-    v_wf_start->resize(n_channels);
-    v_fit_peak_time->resize(n_channels);
-    v_fit_peak_value->resize(n_channels);
-    v_peaking_time->resize(n_channels);
-
-    f_isDa->resize(n_channels);
-
-    fft_mean->resize(n_channels, 0);
-    fft_min->resize(n_channels, 0);
-    fft_max->resize(n_channels, 0);
-
-    fft_mean_freq->resize(n_channels, 0);
-    fft_min_freq->resize(n_channels, 0);
-    fft_max_freq->resize(n_channels, 0);
-    for (auto p: fft_modes) p->clear();
-    for (auto p: fft_values) p->clear();
-} // end ResizeVectors()
-
-void FileWriterTreeDRS4::DoFFTAnalysis(uint8_t iwf){
-    if (!UseWaveForm(fft_waveforms, iwf)) return;
-    fft_mean->at(iwf) = 0;
-    fft_max->at(iwf) = 0;
-    fft_min->at(iwf) = 1e9;
-    fft_mean_freq->at(iwf) = -1;
-    fft_max_freq->at(iwf) = -1;
-    fft_min_freq->at(iwf) = -1;
-    w_fft.Start(false);
-    uint32_t n = uint32_t(data->size());
+void FileWriterTreeDRS4::DoFFTAnalysis(EventData & event, Worker & w){
+    if (!fft_waveforms) return;
+    w.w_fft.Start(false);
+    /** all channels go through one batched transform */
+    const StandardEvent & sev = event.sev;
+    uint8_t channels[16];
+    size_t n_fft = 0;
+    for (uint8_t iwf = 0; iwf < sev.NumWaveforms() and iwf < 16; iwf++)
+        if (UseWaveForm(fft_waveforms, iwf)) channels[n_fft++] = iwf;
+    if (!n_fft) { w.w_fft.Stop(); return; }
+    size_t n = sev.GetWaveform(channels[0]).GetData()->size();
+    w.fft.Resize(n_fft, n);
+    for (size_t i = 0; i < n_fft; i++) {
+        const vector<float> & data = *sev.GetWaveform(channels[i]).GetData();
+        w.fft.SetInput(i, data.data(), data.size());
+    }
+    w.fft.Transform();
     float sample_rate = 2e6;
-    if(fft_own->GetN()[0] != n+1){
-        n_samples = n+1;
-        cout << "Recreating a new VirtualFFT with " << n_samples << " Samples, before " << fft_own->GetN() << endl;
-        delete fft_own;
-        delete in;
-        delete re_full;
-        delete im_full;
-        fft_own = 0;
-        in = new Double_t[n];
-        re_full = new Double_t[n];
-        im_full = new Double_t[n];
-        fft_own = TVirtualFFT::FFT(1, &n_samples, "R2C");
-    }
-    for (uint32_t j = 0; j < n; ++j) in[j] = data->at(j);
-    fft_own->SetPoints(in);
-    fft_own->Transform();
-    fft_own->GetPointsComplex(re_full,im_full);
-    float finalVal = 0;
-    float max = -1;
-    float min = 1e10;
-    float freq;
-    float mean_freq = 0;
-    float min_freq = -1;
-    float max_freq  = -1;
-    float value;
-    for (int j = 0; j < (n/2+1); ++j) {
-        freq = j * sample_rate/n;
-        value = float(TMath::Sqrt(re_full[j]*re_full[j] + im_full[j]*im_full[j]));
-        if (value>max){
-            max = value;
-            max_freq = freq;
-        }
-        if (value<min) {
-            min = value;
-            min_freq = freq;
-        }
-        finalVal+= value;
-        mean_freq += freq * value;
-        fft_values.at(iwf)->push_back(value);
-        if (j < 10 || j == n/2)
-            fft_modes.at(iwf)->push_back(value);
-    }
-    mean_freq /= finalVal;
-    finalVal/= ((n/2) + 1);
-    fft_mean->at(iwf) = finalVal;
-    fft_max->at(iwf) = max;
-    fft_min->at(iwf) = min;
-    fft_mean_freq->at(iwf) = mean_freq;
-    fft_max_freq->at(iwf) = max_freq;
-    fft_min_freq->at(iwf) = min_freq;
-    w_fft.Stop();
-    if (verbose>0 && f_event_number < 1000)
-        cout<<runnumber<<" "<<std::setw(3)<<f_event_number<<" "<<iwf<<" "<<finalVal<<" "<<max<<" "<<min<<endl;
+    float freq_step = sample_rate / n;
+    size_t n_bins = w.fft.NBins();
+    for (size_t i = 0; i < n_fft; i++) {
+        uint8_t iwf = channels[i];
+        const float * values = w.fft.Magnitudes(i);
+        size_t i_max = waveform::ArgMax(values, n_bins);
+        size_t i_min = waveform::ArgMin(values, n_bins);
+        float sum = waveform::Sum(values, n_bins);
+        float weighted_sum = 0;
+        for (size_t j = 0; j < n_bins; j++) weighted_sum += j * values[j];
+        event.fft_mean.at(iwf) = sum / n_bins;
+        event.fft_max.at(iwf) = values[i_max];
+        event.fft_min.at(iwf) = values[i_min];
+        event.fft_mean_freq.at(iwf) = weighted_sum * freq_step / sum;
+        event.fft_max_freq.at(iwf) = i_max * freq_step;
+        event.fft_min_freq.at(iwf) = i_min * freq_step;
+        if (UseWaveForm(fft_save_values, iwf))
+            event.fft_values.at(iwf).assign(values, values + n_bins);
+        // the lowest modes and the highest one
+        vector<float> & modes = event.fft_modes.at(iwf);
+        modes.assign(values, values + std::min(fft_n_modes, n_bins));
+        if (fft_n_modes < n_bins) modes.push_back(values[n_bins - 1]);
+    }
+    w.w_fft.Stop();
 } // end DoFFTAnalysis()
 
-inline void FileWriterTreeDRS4::DoSpectrumFitting(uint8_t iwf){
+inline void FileWriterTreeDRS4::DoSpectrumFitting(EventData & event, Worker & w, uint8_t iwf){
     if (!UseWaveForm(spectrum_waveforms, iwf)) return;
 
-    w_spectrum.Start(false);
-
+    vector<float> & data_pos = w.data_pos;
     float max = *max_element(data_pos.begin(), data_pos.end());
     //return if the max element is lower than 4 sigma of the noise
-    float threshold = 4 * noise->at(iwf).second + noise->at(iwf).first;
+    float threshold = 4 * event.noise.at(iwf).second + event.noise.at(iwf).first;
 
     if (max <= threshold) return;
     // tspec threshold is in per cent to max peak
 
+    w.w_spectrum.Start(false);
     threshold = threshold / max * 100;
     uint16_t size = uint16_t(data_pos.size());
+    w.decon.resize(size, 0);
 
-    n_peaks_total = 0;
-    n_peaks_before_roi = 0;
-    n_peaks_after_roi = 0;
+    event.n_peaks_total = 0;
+    event.n_peaks_before_roi = 0;
+    event.n_peaks_after_roi = 0;
 
-    int peaks = spec->SearchHighRes(&data_pos[0], &decon[0], size, spec_sigma, threshold, spec_rm_bg, spec_decon_iter, spec_markov, spec_aver_win);
-    n_peaks_total = peaks; //this goes in the root file
+    int peaks = w.spec->SearchHighRes(&data_pos[0], &w.decon[0], size, spec_sigma, threshold, spec_rm_bg, spec_decon_iter, spec_markov, spec_aver_win);
+    event.n_peaks_total = peaks; //this goes in the root file
     for(uint8_t i=0; i < peaks; i++){
-        uint16_t bin = uint16_t(spec->GetPositionX()[i] + .5);
+        uint16_t bin = uint16_t(w.spec->GetPositionX()[i] + .5);
         uint16_t min_bin = bin - 5 >= 0 ? uint16_t(bin - 5) : uint16_t(0);
         uint16_t max_bin = bin + 5 < size ? uint16_t(bin + 5) : uint16_t(size - 1);
         max = *std::max_element(&data_pos.at(min_bin), &data_pos.at(max_bin));
-        peaks_x.at(iwf)->push_back(bin);
-        float peaktime = getTriggerTime(iwf, bin);
+        event.peaks_x.at(iwf).push_back(bin);
+        float peaktime = getTriggerTime(iwf, bin, event.trigger_cell);
 
         if (peaktime < peak_finding_roi.first){
-            n_peaks_before_roi++;}
+            event.n_peaks_before_roi++;}
 
         if (peaktime >= peak_finding_roi.second){
-            n_peaks_after_roi++;}
+            event.n_peaks_after_roi++;}
 
-        peaks_x_time.at(iwf)->push_back(peaktime);
-        peaks_y.at(iwf)->push_back(max);
+        event.peaks_x_time.at(iwf).push_back(peaktime);
+        event.peaks_y.at(iwf).push_back(max);
 
     }
-    w_spectrum.Stop();
+    w.w_spectrum.Stop();
 } // end DoSpectrumFitting()
 
 
-void FileWriterTreeDRS4::FillSpectrumData(uint8_t iwf){
+void FileWriterTreeDRS4::FillSpectrumData(Worker & w, uint8_t iwf, const vector<float> & data){
     bool b_spectrum = UseWaveForm(spectrum_waveforms, iwf);
     bool b_fft = UseWaveForm(fft_waveforms, iwf);
     if(b_spectrum || b_fft){
-        data_pos.resize(data->size());
-        for (uint16_t i = 0; i < data->size(); i++)
-            data_pos.at(i) = spectrum_polarities.at(iwf) * data->at(i);
+        w.data_pos.resize(data.size());
+        for (uint16_t i = 0; i < data.size(); i++)
+            w.data_pos.at(i) = spectrum_polarities.at(iwf) * data.at(i);
     }
 } // end FillSpectrumData()
 
-void FileWriterTreeDRS4::calc_noise(uint8_t iwf) {
-  float value = data->at(peak_noise_pos);
+void FileWriterTreeDRS4::calc_noise(uint8_t iwf, const vector<float> & data) {
+  float value = data.at(peak_noise_pos);
   // filter out peaks at the pedestal
   if (std::abs(value) < 6 * noise->at(iwf).second + std::abs(noise->at(iwf).first) or noise_vectors.at(iwf)->size() < 10)
     noise_vectors.at(iwf)->push_back(value);
@@ -736,107 +962,111 @@ void FileWriterTreeDRS4::calc_noise(uint8_t iwf) {
   noise->at(iwf) = calc_mean(*noise_vectors.at(iwf));
 }
 
-void FileWriterTreeDRS4::FillRegionIntegrals(const StandardEvent sev){
-
-    uint8_t i = 0;
-    for (auto channel: *regions){
-      const StandardWaveform * wf = &sev.GetWaveform(channel.first);
-      channel.second->GetRegion(0)->SetPeakPostion(5);
-      for (auto region: channel.second->GetRegions()){
-        signed char polarity = (string(region->GetName()).find("pulser") != string::npos) ? channel.second->GetPulserPolarity() : channel.second->GetPolarity();
-        uint16_t peak_pos = wf->getIndex(region->GetLowBoarder(), region->GetHighBoarder(), polarity);
-        region->SetPeakPostion(peak_pos);
-        if (string(region->GetName()) == "signal_b"){  // TODO change this naming or define a definite signal region
-          v_cft[i++] = wf->getCFT(region->GetLowBoarder(), region->GetHighBoarder(), rise_time * 2); }
-        for (auto integral: region->GetIntegrals()){
-          std::string name = integral->GetName();
-          std::transform(name.begin(), name.end(), name.begin(), ::tolower);
-          integral->SetPeakPosition(peak_pos, wf->GetNSamples());
-          integral->SetTimeIntegral(wf->getIntegral(integral->GetIntegralStart(), integral->GetIntegralStop(), peak_pos, 2.0));
-          if (name.find("peaktopeak")!=std::string::npos){
-            integral->SetIntegral(wf->getPeakToPeak(integral->GetIntegralStart(), integral->GetIntegralStop()));
-          } else if (name.find("median")!=name.npos){
-            integral->SetIntegral(wf->getMedian(integral->GetIntegralStart(), integral->GetIntegralStop()));
-          } else
-            integral->SetIntegral(wf->getIntegral(integral->GetIntegralStart(), integral->GetIntegralStop()));
-        }
+void FileWriterTreeDRS4::FillRegionIntegrals(EventData & event, Worker & w){
+
+    size_t n = plan.kinds.size();
+    event.integral_values.resize(n);
+    event.time_integral_values.resize(n);
+    event.integral_peaks.resize(n);
+    event.integral_peak_time.resize(n);
+    event.integral_length.resize(n);
+    const StandardWaveform * wf = 0;
+    int channel = -1;
+    for (const auto & region: plan.regions){
+      if (region.channel != channel) {
+        channel = region.channel;
+        wf = &event.sev.GetWaveform(region.channel);
+        // all integrals of the channel are answered from the running sums
+        const vector<float> & times = wf->GetTimes();
+        w.sums.Build(wf->GetData()->data(), wf->GetData()->size(), times.empty() ? 0 : times.data());
       }
-    }
-} // end FillRegionIntegrals()
-
-void FileWriterTreeDRS4::FillRegionVectors(){
-    IntegralValues->clear();
-    TimeIntegralValues->clear();
-    IntegralPeaks->clear();
-    IntegralPeakTime->clear();
-    IntegralLength->clear();
-    for (auto ch: *regions){
-      for (auto region: ch.second->GetRegions()) {
-        uint16_t peak_pos = region->GetPeakPosition();
-        for (auto integral: region->GetIntegrals()) {
-          IntegralValues->push_back(integral->GetIntegral());
-          TimeIntegralValues->push_back(integral->GetTimeIntegral());
-          IntegralPeaks->emplace_back(peak_pos);
-          IntegralPeakTime->push_back(getTriggerTime(ch.first, peak_pos));
-          IntegralLength->push_back(getTimeDifference(ch.first, integral->GetIntegralStart(), integral->GetIntegralStop()));
+      int n_samples = wf->GetNSamples();
+      uint16_t peak_pos = wf->getIndex(region.low, region.high, region.polarity);
+      float peak_time = getTriggerTime(region.channel, peak_pos, event.trigger_cell);
+      if (region.cft >= 0)
+        event.cft.at(region.cft) = wf->getCFT(region.low, region.high, rise_time * 2);
+      for (size_t i = region.first; i < region.last; i++){
+        uint16_t start = uint16_t(std::max(peak_pos - plan.down[i], 0));
+        uint16_t stop = uint16_t(std::min(peak_pos + plan.up[i], n_samples));
+        event.time_integral_values[i] = w.sums.TimeIntegral(start, stop, peak_pos, 2.0);
+        switch (plan.kinds[i]) {
+          case IntegralPlan::PEAKTOPEAK:
+            event.integral_values[i] = wf->getPeakToPeak(start, stop);
+            break;
+          case IntegralPlan::MEDIAN:
+            event.integral_values[i] = wf->getMedian(start, stop);
+            break;
+          default:
+            event.integral_values[i] = w.sums.Integral(start, stop);
         }
+        event.integral_peaks[i] = peak_pos;
+        event.integral_peak_time[i] = peak_time;
+        event.integral_length[i] = getTimeDifference(region.channel, start, stop, event.trigger_cell);
       }
     }
-}
+} // end FillRegionIntegrals()
 
-void FileWriterTreeDRS4::FillTotalRange(uint8_t iwf, const StandardWaveform *wf){
+void FileWriterTreeDRS4::FillTotalRange(EventData & event, Worker & w, uint8_t iwf, const StandardWaveform *wf){
 
     signed char pol = polarities.at(iwf);
-    v_is_saturated->at(iwf) = wf->getAbsMaxInRange(0, 1023) > 498; // indicator if saturation is reached in sampling region (1-1024)
-    v_median->at(iwf) = pol * wf->getMedian(0, 1023); // Median over whole sampling region
-    v_average->at(iwf) = pol * wf->getIntegral(0, 1023);
+    const pair<float, float> & noise = event.noise.at(iwf);
+    event.is_saturated.at(iwf) = wf->getAbsMaxInRange(0, 1023) > 498; // indicator if saturation is reached in sampling region (1-1024)
+    event.median.at(iwf) = pol * wf->getMedian(0, 1023); // Median over whole sampling region
+    event.average.at(iwf) = pol * wf->getIntegral(0, 1023);
     if (UseWaveForm(active_regions, iwf)){
 
-        WaveformSignalRegion * reg = regions->at(iwf)->GetRegion("signal_b");
-        v_rise_time->at(iwf) = wf->getRiseTime(reg->GetLowBoarder(), uint16_t(reg->GetHighBoarder() + 10), noise->at(iwf).first);
-        v_fall_time->at(iwf) = wf->getFallTime(reg->GetLowBoarder(), uint16_t(reg->GetHighBoarder() + 10), noise->at(iwf).first);
-        auto fit_peak = wf->fitMaximum(reg->GetLowBoarder(), reg->GetHighBoarder());
-        v_fit_peak_time->at(iwf) = fit_peak.first;
-        v_fit_peak_value->at(iwf) = fit_peak.second;
-        v_wf_start->at(iwf) = wf->getWFStartTime(reg->GetLowBoarder(), reg->GetHighBoarder(), noise->at(iwf).first, fit_peak.second);
-        v_peaking_time->at(iwf) = v_fit_peak_time->at(iwf) - v_wf_start->at(iwf);
+        const IntegralPlan::Region & reg = plan.regions.at(plan.signal_region.at(iwf));
+        event.rise_time.at(iwf) = wf->getRiseTime(reg.low, uint16_t(reg.high + 10), noise.first);
+        event.fall_time.at(iwf) = wf->getFallTime(reg.low, uint16_t(reg.high + 10), noise.first);
+        if (UseWaveForm(fast_fit_waveforms, iwf)) {
+            auto fit_peak = wf->interpolateMaximum(reg.low, reg.high, UseWaveForm(gauss_fit_waveforms, iwf));
+            event.fit_peak_time.at(iwf) = fit_peak.first;
+            event.fit_peak_value.at(iwf) = fit_peak.second;
+            event.wf_start.at(iwf) = wf->getWFStartTimeLinear(reg.low, reg.high, noise.first, fit_peak.second);
+        } else {
+            /** the Minuit fits use global state */
+            std::unique_lock<std::mutex> lock(m_fit_mutex);
+            auto fit_peak = wf->fitMaximum(reg.low, reg.high);
+            event.fit_peak_time.at(iwf) = fit_peak.first;
+            event.fit_peak_value.at(iwf) = fit_peak.second;
+            event.wf_start.at(iwf) = wf->getWFStartTime(reg.low, reg.high, noise.first, fit_peak.second);
+        }
+        event.peaking_time.at(iwf) = event.fit_peak_time.at(iwf) - event.wf_start.at(iwf);
         pair<uint16_t, float> peak = wf->getMaxPeak();
-        v_max_peak_position->at(iwf) = peak.first;
-        v_max_peak_time->at(iwf) = getTriggerTime(iwf, peak.first);
-        float threshold = polarities.at(iwf) * 4 * noise->at(iwf).second + noise->at(iwf).first;
-        vector<uint16_t> * peak_positions = wf->getAllPeaksAbove(0, 1023, threshold);
-        v_peak_positions->at(iwf) = *peak_positions;
-        v_npeaks->at(iwf) = uint8_t(v_peak_positions->at(iwf).size());
-        vector<float> peak_timings;
-        for (auto i_pos:*peak_positions) peak_timings.push_back(getTriggerTime(iwf, i_pos));
-        v_peak_times->at(iwf) = peak_timings;
+        event.max_peak_position.at(iwf) = peak.first;
+        event.max_peak_time.at(iwf) = getTriggerTime(iwf, peak.first, event.trigger_cell);
+        float threshold = polarities.at(iwf) * 4 * noise.second + noise.first;
+        vector<uint16_t> & peak_positions = event.peak_positions.at(iwf);
+        wf->getAllPeaksAbove(0, 1023, threshold, peak_positions);
+        event.npeaks.at(iwf) = uint8_t(peak_positions.size());
+        for (auto i_pos:peak_positions) event.peak_times.at(iwf).push_back(getTriggerTime(iwf, i_pos, event.trigger_cell));
     }
 }
 
-void FileWriterTreeDRS4::UpdateWaveforms(uint8_t iwf){
+void FileWriterTreeDRS4::UpdateWaveforms(uint8_t iwf, const vector<float> & data){
 
-    for (uint16_t j = 0; j < data->size(); j++) {
+    for (uint16_t j = 0; j < data.size(); j++) {
         if (UseWaveForm(save_waveforms, iwf))
-            f_wf.at(uint8_t(iwf))->emplace_back(data->at(j));
+            f_wf.at(uint8_t(iwf))->emplace_back(data.at(j));
         if     (iwf == 0) {
             if (f_pulser)
-                avgWF_0_pul->SetBinContent(j+1, avgWF(float(avgWF_0_pul->GetBinContent(j+1)),data->at(j),f_pulser_events));
+                avgWF_0_pul->SetBinContent(j+1, avgWF(float(avgWF_0_pul->GetBinContent(j+1)),data.at(j),f_pulser_events));
             else
-                avgWF_0_sig->SetBinContent(j+1, avgWF(float(avgWF_0_sig->GetBinContent(j+1)),data->at(j),f_signal_events));
-            avgWF_0->SetBinContent(j+1, avgWF(float(avgWF_0->GetBinContent(j+1)),data->at(j),f_event_number+1));
+                avgWF_0_sig->SetBinContent(j+1, avgWF(float(avgWF_0_sig->GetBinContent(j+1)),data.at(j),f_signal_events));
+            avgWF_0->SetBinContent(j+1, avgWF(float(avgWF_0->GetBinContent(j+1)),data.at(j),f_event_number+1));
         }
         else if(iwf == 1) {
-            avgWF_1->SetBinContent(j+1, avgWF(float(avgWF_1->GetBinContent(j+1)),data->at(j),f_event_number+1));
+            avgWF_1->SetBinContent(j+1, avgWF(float(avgWF_1->GetBinContent(j+1)),data.at(j),f_event_number+1));
         }
         else if(iwf == 2) {
-            avgWF_2->SetBinContent(j+1, avgWF(float(avgWF_2->GetBinContent(j+1)),data->at(j),f_event_number+1));
+            avgWF_2->SetBinContent(j+1, avgWF(float(avgWF_2->GetBinContent(j+1)),data.at(j),f_event_number+1));
         }
         else if(iwf == 3) {
             if (f_pulser)
-                avgWF_3_pul->SetBinContent(j+1, avgWF(float(avgWF_3_pul->GetBinContent(j+1)),data->at(j),f_pulser_events));
+                avgWF_3_pul->SetBinContent(j+1, avgWF(float(avgWF_3_pul->GetBinContent(j+1)),data.at(j),f_pulser_events));
             else
-                avgWF_3_sig->SetBinContent(j+1, avgWF(float(avgWF_3_sig->GetBinContent(j+1)),data->at(j),f_signal_events));
-            avgWF_3->SetBinContent(j+1, avgWF(float(avgWF_3->GetBinContent(j+1)),data->at(j),f_event_number+1));
+                avgWF_3_sig->SetBinContent(j+1, avgWF(float(avgWF_3_sig->GetBinContent(j+1)),data.at(j),f_signal_events));
+            avgWF_3->SetBinContent(j+1, avgWF(float(avgWF_3->GetBinContent(j+1)),data.at(j),f_event_number+1));
         }
     } // data loop
 } // end UpdateWaveforms()
@@ -846,41 +1076,35 @@ inline int FileWriterTreeDRS4::IsPulserEvent(const StandardWaveform *wf){
     return pulser_int > pulser_threshold;
 } //end IsPulserEvent
 
-inline void FileWriterTreeDRS4::ExtractForcTiming(vector<float> * data) {
+inline void FileWriterTreeDRS4::ExtractForcTiming(EventData & event, const vector<float> & data) {
     bool found_timing = false;
-    for (uint16_t j=1; j < data->size(); j++){
-        if( abs(data->at(j)) > 200 && abs(data->at(uint16_t(j - 1))) < 200) {
-            v_forc_pos->push_back(j);
-            v_forc_time->push_back(getTriggerTime(trigger_channel, j));
+    for (uint16_t j=1; j < data.size(); j++){
+        if( abs(data.at(j)) > 200 && abs(data.at(uint16_t(j - 1))) < 200) {
+            event.forc_pos.push_back(j);
+            event.forc_time.push_back(getTriggerTime(trigger_channel, j, event.trigger_cell));
             found_timing = true;
         }
     }
     if (!found_timing) {
-        v_forc_pos->push_back(0);
-        v_forc_time->push_back(-999);
+        event.forc_pos.push_back(0);
+        event.forc_time.push_back(-999);
     }
 } //end ExtractForcTiming()
 
 void FileWriterTreeDRS4::FillFullTime(){
     uint16_t n_waveform_samples = uint16_t(tcal.at(0).size() / 2);  // tcal vec is two times to big atm, todo: fix that!
-    for (auto i_ch:tcal){
-        i_ch.second.resize(n_waveform_samples);
-        float sum = 0;
-        full_time[i_ch.first] = vector<float>();
-        full_time.at(i_ch.first).push_back(sum);
-        for (uint16_t j = 0; j < i_ch.second.size() * 2 - 1; j++){
-            sum += i_ch.second.at(uint16_t(j % 1024));
-            full_time.at(i_ch.first).push_back(sum);
-        }
-    }
+    time_calibration.clear();
+    // the waveform time axes all use the calibration of the first channel, so only that one gets the per cell tables
+    for (const auto & i_ch: tcal)
+        time_calibration[i_ch.first] = TimeCalibration(i_ch.second, n_waveform_samples, i_ch.first == 0);
 }
 
-inline float FileWriterTreeDRS4::getTriggerTime(const uint8_t & ch, const uint16_t & bin) {
-    return full_time.at(ch).at(bin + f_trigger_cell) - full_time.at(ch).at(f_trigger_cell);
+inline float FileWriterTreeDRS4::getTriggerTime(const uint8_t & ch, const uint16_t & bin, const uint16_t & trigger_cell) {
+    return time_calibration.at(ch).GetTriggerTime(bin, trigger_cell);
 }
 
-float FileWriterTreeDRS4::getTimeDifference(uint8_t ch, uint16_t bin_low, uint16_t bin_up) {
-    return full_time.at(ch).at(bin_up + f_trigger_cell) - full_time.at(ch).at(uint16_t(bin_low + f_trigger_cell));
+float FileWriterTreeDRS4::getTimeDifference(uint8_t ch, uint16_t bin_low, uint16_t bin_up, uint16_t trigger_cell) {
+    return time_calibration.at(ch).GetTimeDifference(bin_low, bin_up, trigger_cell);
 }
 
 string FileWriterTreeDRS4::GetBitMask(uint16_t bitmask){
@@ -898,37 +1122,43 @@ string FileWriterTreeDRS4::GetPolarities(vector<signed char> pol) {
     return trim(ss.str(), " ");
 }
 
-void FileWriterTreeDRS4::SetTimeStamp(StandardEvent sev) {
+void FileWriterTreeDRS4::SetTimeStamp(EventData & event) {
+    StandardEvent & sev = event.sev;
     if (sev.hasTUEvent()){
         if (sev.GetTUEvent(0).GetValid())
-            f_time = sev.GetTimestamp();
+            m_time = sev.GetTimestamp();
     }
     else
-        f_time = sev.GetTimestamp() / 384066.;
+        m_time = sev.GetTimestamp() / 384066.;
+    event.time = m_time;
 }
 
-void FileWriterTreeDRS4::SetBeamCurrent(StandardEvent sev) {
+void FileWriterTreeDRS4::SetBeamCurrent(EventData & event) {
 
+    StandardEvent & sev = event.sev;
     if (sev.hasTUEvent()){
-        StandardTUEvent tuev = sev.GetTUEvent(0);
-        f_beam_current = uint16_t(tuev.GetValid() ? tuev.GetBeamCurrent() : UINT16_MAX);
+        const StandardTUEvent & tuev = sev.GetTUEvent(0);
+        m_beam_current = uint16_t(tuev.GetValid() ? tuev.GetBeamCurrent() : UINT16_MAX);
     }
+    event.beam_current = m_beam_current;
 }
 
-void FileWriterTreeDRS4::SetScalers(StandardEvent sev) {
+void FileWriterTreeDRS4::SetScalers(EventData & event) {
 
+    StandardEvent & sev = event.sev;
+    event.scaler.resize(5);
     if (sev.hasTUEvent()) {
-        StandardTUEvent tuev = sev.GetTUEvent(0);
+        const StandardTUEvent & tuev = sev.GetTUEvent(0);
         bool valid = tuev.GetValid();
         /** scaler continuously count upwards: subtract old scaler value and divide by time interval to get rate
          *  first scaler value is the scintillator and then the planes */
         for (uint8_t i(0); i < 5; i++) {
-                v_scaler->at(i) = uint64_t(valid ? (tuev.GetScalerValue(i) - old_scaler->at(i)) * 1000 / (f_time - old_time) : UINT32_MAX);
+                event.scaler.at(i) = uint64_t(valid ? (tuev.GetScalerValue(i) - old_scaler->at(i)) * 1000 / (event.time - old_time) : UINT32_MAX);
                 if (valid)
                     old_scaler->at(i) = tuev.GetScalerValue(i);
             }
         if (valid)
-            old_time = f_time;
+            old_time = event.time;
         }
 }
 
@@ -983,4 +1213,46 @@ void FileWriterTreeDRS4::ReadIntegralRegions() {
   }
 }
 
+void FileWriterTreeDRS4::IntegralPlan::Clear() {
+  regions.clear();
+  kinds.clear();
+  down.clear();
+  up.clear();
+  signal_region.clear();
+}
+
+void FileWriterTreeDRS4::CompileIntegralPlan() {
+
+  /** same order as the [Integral Names] in the macro */
+  plan.Clear();
+  int n_cft(0);
+  for (auto ch: *regions){
+    for (auto region: ch.second->GetRegions()){
+      string name = region->GetName();
+      IntegralPlan::Region reg;
+      reg.channel = ch.first;
+      reg.polarity = (name.find("pulser") != string::npos) ? ch.second->GetPulserPolarity() : ch.second->GetPolarity();
+      reg.low = region->GetLowBoarder();
+      reg.high = region->GetHighBoarder();
+      reg.cft = -1;
+      if (name == "signal_b"){  // TODO change this naming or define a definite signal region
+        reg.cft = n_cft++;
+        plan.signal_region[ch.first] = plan.regions.size();
+      }
+      reg.first = plan.kinds.size();
+      for (auto integral: region->GetIntegrals()){
+        string i_name = integral->GetName();
+        std::transform(i_name.begin(), i_name.end(), i_name.begin(), ::tolower);
+        if (i_name.find("peaktopeak") != string::npos)  plan.kinds.push_back(IntegralPlan::PEAKTOPEAK);
+        else if (i_name.find("median") != string::npos) plan.kinds.push_back(IntegralPlan::MEDIAN);
+        else                                            plan.kinds.push_back(IntegralPlan::INTEGRAL);
+        plan.down.push_back(integral->GetDownRange());
+        plan.up.push_back(integral->GetUpRange());
+      }
+      reg.last = plan.kinds.size();
+      plan.regions.push_back(reg);
+    }
+  }
+}
+
 #endif // ROOT_FOUND
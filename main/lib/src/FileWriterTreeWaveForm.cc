@@ -465,7 +465,7 @@ string FileWriterTreeWaveForm::GetPolarities(vector<signed char> pol) {
     return trim(ss.str(), " ");
 }
 
-void FileWriterTreeWaveForm::SetTimeStamp(StandardEvent sev) {
+void FileWriterTreeWaveForm::SetTimeStamp(const StandardEvent & sev) {
     if (sev.hasTUEvent()){
         if (sev.GetTUEvent(0).GetValid())
             f_time = sev.GetTimestamp();
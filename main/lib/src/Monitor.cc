@@ -18,7 +18,8 @@ namespace eudaq {
     limit(lim),
     skip(100-skip_),
     skip_events_with_counter(skip_evts),
-    start_event(0)
+    start_event(0),
+    m_start_seeked(false)
   {
     if (datafile != "") {
       // set offline
@@ -34,7 +35,11 @@ namespace eudaq {
   bool Monitor::ProcessEvent() {
 
     if (!m_reader.get()) return false;
-    if (!m_reader->NextEvent()) return false;
+    if (start_event > 0 && !m_start_seeked) {
+      // jump to the start event instead of reading everything before it
+      m_start_seeked = true;
+      if (!m_reader->SeekEvent(start_event)) return false;
+    } else if (!m_reader->NextEvent()) return false;
 
     unsigned evt_number = m_reader->GetDetectorEvent().GetEventNumber();
     //  std::cout<< "at event number; " << evt_number << std::endl;
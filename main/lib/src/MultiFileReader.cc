@@ -1,8 +1,9 @@
 #include "eudaq/MultiFileReader.hh"
+#include <algorithm>
 
-void eudaq::multiFileReader::addFileReader( const std::string & filename, const std::string & filepattern /*= ""*/ )
+void eudaq::multiFileReader::addFileReader( const std::string & filename, const std::string & filepattern /*= ""*/, bool mapped /*= false*/ )
 {
-	m_fileReaders.emplace_back(std::make_shared<FileReader>(filename,  filepattern));
+	m_fileReaders.emplace_back(std::make_shared<FileReader>(filename,  filepattern, mapped));
 	m_ev=m_fileReaders.back()->GetDetectorEvent_ptr();
 	m_sync.addBOREEvent(m_fileReaders.size()-1,*m_ev);
 }
@@ -21,22 +22,58 @@ bool eudaq::multiFileReader::NextEvent( size_t skip /*= 0*/ ) {
     m_preaparedForEvents=true;
   }
   for (size_t skipIndex=0;skipIndex<=skip;skipIndex++) {
-    do {
-      for (size_t fileID = 0; fileID < m_fileReaders.size(); ++fileID)
-      {
-        if (!m_fileReaders[fileID]->NextEvent() && m_sync.SubEventQueueIsEmpty(fileID)) {
-          return false;
-        }
-        m_sync.AddDetectorElementToProducerQueue(fileID,m_fileReaders[fileID]->GetDetectorEvent_ptr());
+    if (!SyncEvents(true)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool eudaq::multiFileReader::SyncEvents(bool read) {
+  // with read == false the current events of the file readers are used first
+  do {
+    for (size_t fileID = 0; fileID < m_fileReaders.size(); ++fileID)
+    {
+      if (read && !m_fileReaders[fileID]->NextEvent() && m_sync.SubEventQueueIsEmpty(fileID)) {
+        return false;
       }
-      m_sync.storeCurrentOrder();
-    } while (!m_sync.SyncNEvents(m_eventsToSync));
+      m_sync.AddDetectorElementToProducerQueue(fileID,m_fileReaders[fileID]->GetDetectorEvent_ptr());
+    }
+    read = true;
+    m_sync.storeCurrentOrder();
+  } while (!m_sync.SyncNEvents(m_eventsToSync));
+
+  return m_sync.getNextEvent(m_ev);
+}
+
+bool eudaq::multiFileReader::SeekEvent(unsigned n) {
 
-    if (!m_sync.getNextEvent(m_ev)) {
+  if (!m_preaparedForEvents) {
+    m_sync.PrepareForEvents();
+    m_preaparedForEvents=true;
+  }
+  for (auto& p : m_fileReaders) {
+    if (!p->SeekEvent(n)) {
       return false;
     }
   }
-  return true;
+  // the queued events are from before the jump
+  m_sync.clearQueues();
+  return SyncEvents(false);
+}
+
+bool eudaq::multiFileReader::NextEvent(const std::vector<unsigned> & numbers) {
+
+  if (numbers.empty() || !m_ev) {
+    return NextEvent();
+  }
+  // the BORE shares its event number with the first event
+  unsigned current = m_ev->GetEventNumber();
+  auto next = m_ev->IsBORE() ? std::lower_bound(numbers.begin(), numbers.end(), current) : std::upper_bound(numbers.begin(), numbers.end(), current);
+  if (next == numbers.end() || *next <= current + 1) {
+    return NextEvent();
+  }
+  return SeekEvent(*next);
 }
 
 const eudaq::DetectorEvent & eudaq::multiFileReader::GetDetectorEvent() const
@@ -0,0 +1,53 @@
+#include "eudaq/PHCalibration.hh"
+
+#include <TMath.h>
+#include <limits>
+
+namespace eudaq {
+
+  void PHCalibration::Clear() {
+    m_n_rocs = 0;
+    m_n_adc = 0;
+    m_pars.clear();
+    m_valid.clear();
+    m_lut.clear();
+  }
+
+  void PHCalibration::Set(size_t roc, int col, int row, const VCALDict & d) {
+    if (col < 0 or col >= NCOLS or row < 0 or row >= NROWS) return;
+    if (roc >= m_n_rocs) {
+      m_n_rocs = roc + 1;
+      m_pars.resize(m_n_rocs * NCOLS * NROWS);
+      m_valid.resize(m_pars.size(), 0);
+      if (m_n_adc) m_lut.resize(m_pars.size() * m_n_adc);
+    }
+    size_t i = Index(roc, col, row);
+    m_pars[i] = d;
+    m_valid[i] = 1;
+    for (size_t adc = 0; adc < m_n_adc; adc++)
+      m_lut[i * m_n_adc + adc] = Invert(d, adc);
+  }
+
+  void PHCalibration::BuildLUT(size_t n_adc) {
+    m_n_adc = n_adc;
+    m_lut.assign(m_pars.size() * n_adc, Uncalibrated());
+    for (size_t i = 0; i < m_pars.size(); i++) {
+      if (!m_valid[i]) continue;
+      for (size_t adc = 0; adc < n_adc; adc++)
+        m_lut[i * n_adc + adc] = Invert(m_pars[i], adc);
+    }
+  }
+
+  float PHCalibration::Invert(const VCALDict & d, double adc) {
+    /** TF1::GetX only finds roots inside the function range and returns 0 otherwise */
+    static const double xmin = -4096, xmax = 4096;
+    double y = adc / d.par3 - d.par2;
+    if (!(y > -1 and y < 1)) return 0;
+    double x = d.par0 + d.par1 * TMath::ErfInverse(y);
+    if (!(x >= xmin and x <= xmax)) return 0;
+    return d.calibration_factor * float(x);
+  }
+
+  float PHCalibration::Uncalibrated() { return std::numeric_limits<float>::quiet_NaN(); }
+
+}
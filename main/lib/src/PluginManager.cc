@@ -20,13 +20,47 @@ using namespace std;
 
 namespace eudaq {
 
+  namespace {
+    // plugin manager of the current thread, if it doesn't use the global one
+    thread_local PluginManager * t_instance = 0;
+  }
+
   PluginManager & PluginManager::GetInstance() {
+    if (t_instance) return *t_instance;
     // the only one static instance of the plugin manager is in the getInstance function
     // like this it is ensured that the instance is created before it is used
     static PluginManager manager;
     return manager;
   }
 
+  PluginManager * PluginManager::Clone() const {
+    PluginManager * result = new PluginManager;
+    for (std::map<t_eventid, DataConverterPlugin *>::const_iterator it = m_pluginmap.begin(); it != m_pluginmap.end(); ++it) {
+      DataConverterPlugin * clone = it->second->Clone();
+      if (clone) result->m_clones.push_back(clone);
+      result->m_pluginmap[it->first] = clone ? clone : it->second;
+    }
+    return result;
+  }
+
+  void PluginManager::SetThreadInstance(PluginManager * manager) {
+    t_instance = manager;
+  }
+
+  PluginManager::ThreadInstanceGuard::ThreadInstanceGuard(PluginManager * manager) : m_previous(t_instance) {
+    t_instance = manager;
+  }
+
+  PluginManager::ThreadInstanceGuard::~ThreadInstanceGuard() {
+    t_instance = m_previous;
+  }
+
+  PluginManager::~PluginManager() {
+    for (size_t i = 0; i < m_clones.size(); ++i) {
+      delete m_clones[i];
+    }
+  }
+
   void PluginManager::RegisterPlugin(DataConverterPlugin * plugin) {
     m_pluginmap[plugin->GetEventType()] = plugin;
   }
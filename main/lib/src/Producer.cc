@@ -12,4 +12,8 @@ namespace eudaq {
   void Producer::OnData(const std::string & param) {
     Connect(param);
   }
+
+  void Producer::AddStatusTags() {
+    FillStatus(m_status);
+  }
 }
@@ -9,18 +9,48 @@ namespace eudaq {
 
   RawDataEvent::block_t::block_t(Deserializer & des) {
     des.read(id);
-    des.read(data);
+    // same layout as des.read(data), but keep a reference if the deserializer allows it
+    unsigned len = 0;
+    des.read(len);
+    const byte_t * ptr = des.View(len, source);
+    if (ptr) {
+      view = data_view(ptr, len);
+      copy = std::make_shared<ViewCopy>();
+    } else {
+      data.resize(len);
+      if (len) des.read(&data[0], len);
+    }
   }
 
   void RawDataEvent::block_t::Serialize(Serializer & ser) const {
     ser.write(id);
-    ser.write(data);
+    if (source) {
+      ser.write((unsigned)view.size());
+      ser.append(view.data(), view.size());
+    } else {
+      ser.write(data);
+    }
   }
 
   void RawDataEvent::block_t::Append(const RawDataEvent::data_t & d) {
+    Materialize();
     data.insert(data.end(), d.begin(), d.end());
   }
 
+  void RawDataEvent::block_t::Materialize() {
+    if (!source) return;
+    data.assign(view.begin(), view.end());
+    view = data_view();
+    source.reset();
+    copy.reset();
+  }
+
+  const RawDataEvent::data_t & RawDataEvent::block_t::Vector() const {
+    if (!source) return data;
+    std::call_once(copy->once, [this] { copy->data.assign(view.begin(), view.end()); });
+    return copy->data;
+  }
+
   RawDataEvent::RawDataEvent(std::string type, unsigned run, unsigned event) :
     Event(run, event),
     m_type(type)
@@ -39,7 +69,8 @@ namespace eudaq {
   }
 
   const RawDataEvent::data_t & RawDataEvent::GetBlock(size_t i) const {
-    return m_blocks.at(i).data;
+    // blocks referencing a mapped file are only copied when they are requested as vector
+    return m_blocks.at(i).Vector();
   }
 
   RawDataEvent::byte_t RawDataEvent::GetByte(size_t block, size_t index) const {
@@ -8,6 +8,8 @@
 #include "TFitResult.h"
 #include "TGraphErrors.h"
 #include <algorithm>
+#include <limits>
+#include <numeric>
 
 using namespace std;
 
@@ -62,13 +64,7 @@ unsigned StandardWaveform::ID() const {
 float StandardWaveform::getIntegral(uint16_t min, uint16_t max, bool _abs) const {
   if (max > this->GetNSamples() - 1) max = uint16_t(this->GetNSamples() - 1);
   if (min < 0) min = 0;
-  float integral = 0;
-  for (uint16_t i = min; i <= max; i++) {
-    if (!_abs)
-      integral += m_samples.at(i);
-    else
-      integral += std::abs(m_samples.at(i));
-  }
+  float integral = min <= max ? waveform::Sum(&m_samples.at(min), size_t(max - min + 1), _abs) : 0;
   return integral / (float) (max - (int) min);
 }
 
@@ -86,14 +82,14 @@ float StandardWaveform::getIntegral(uint16_t low_bin, uint16_t high_bin, uint16_
   while (low_length <= max_low_length - 0.001) {
     float width = min(getBinWidth(--ibin), max_low_length - low_length);  // take the diff between max und current length if it gets smaller than bin width
     bool full_int = width < max_low_length - low_length; // full integral if rest of the total width is bigger than the actual bin width
-    integral += width * (full_int ? (m_samples.at(ibin) + m_samples.at(ibin + 1)) / 2 : interpolateVoltage(ibin + 1, m_times.at(ibin + 1) - width));
+    integral += width * (full_int ? (m_samples.at(ibin) + m_samples.at(ibin + 1)) / 2 : interpolateVoltage(ibin + 1, GetTimes().at(ibin + 1) - width));
     low_length += width;
   }
   ibin = uint16_t(peak_pos - 1);
   while (high_length <= max_high_length - 0.001) {
     float width = min(getBinWidth(++ibin), max_high_length - high_length);  // take the diff between max und current length if it gets smaller than bin width
     bool full_int = width < max_high_length - high_length; // full integral if rest of the total width is bigger than the actual bin width
-    integral += width * (full_int ? (m_samples.at(ibin) + m_samples.at(ibin + 1)) / 2 : interpolateVoltage(ibin + 1, m_times.at(ibin) + width));
+    integral += width * (full_int ? (m_samples.at(ibin) + m_samples.at(ibin + 1)) / 2 : interpolateVoltage(ibin + 1, GetTimes().at(ibin) + width));
     high_length += width;
   }
   return integral / (max_high_length + max_low_length);
@@ -111,6 +107,11 @@ TF1 StandardWaveform::getRFFit(std::vector<float> *tcal) const {
   return fit;
 }
 
+const std::vector<float> & StandardWaveform::GetTimes() const {
+  static const std::vector<float> no_times;
+  return m_times ? *m_times : no_times;
+}
+
 std::vector<float> StandardWaveform::getCalibratedTimes(std::vector<float> *tcal) const {
 
   std::vector<float> t = {tcal->at(m_trigger_cell)};
@@ -122,8 +123,8 @@ std::vector<float> StandardWaveform::getCalibratedTimes(std::vector<float> *tcal
 float StandardWaveform::getPeakFit(uint16_t bin_low, uint16_t bin_high, signed char pol) const {
 
   uint16_t high_bin = getIndex(bin_low, bin_high, pol);
-  float t_high = m_times.at(high_bin);
-  vector<float> t = vector<float>(m_times.begin() + high_bin - 50, m_times.begin() + high_bin + 5);
+  float t_high = GetTimes().at(high_bin);
+  vector<float> t = vector<float>(GetTimes().begin() + high_bin - 50, GetTimes().begin() + high_bin + 5);
   std::vector<float> v = std::vector<float>(m_samples.begin() + high_bin - 50, m_samples.begin() + high_bin + 5);
   TGraph gr = TGraph(unsigned(t.size()), &t[0], &v[0]);
   TF1 fit("fit", "[0]*TMath::Landau(x, [1], [2]) - [3]", 0, 500);
@@ -140,8 +141,8 @@ TF1 StandardWaveform::getErfFit(uint16_t bin_low, uint16_t bin_high, signed char
     return fit;
   }
   uint16_t high_bin = getIndex(bin_low, bin_high, pol);
-  float t_high = m_times.at(high_bin);
-  TGraph gr = TGraph(unsigned(m_times.size()), &m_times[0], &m_samples[0]);
+  float t_high = GetTimes().at(high_bin);
+  TGraph gr = TGraph(unsigned(GetTimes().size()), &GetTimes()[0], &m_samples[0]);
   fit.SetParameters(100, t_high, pol * .5, pol * 100);
   fit.SetParLimits(0, 10, 500);
   fit.SetParLimits(1, t_high - 20, t_high + 2);
@@ -152,16 +153,16 @@ TF1 StandardWaveform::getErfFit(uint16_t bin_low, uint16_t bin_high, signed char
 float StandardWaveform::interpolateTime(uint16_t ibin, float value) const {
 
   /** v = mt + a */
-  float m = (m_samples.at(ibin) - m_samples.at(uint16_t(ibin - 1))) / (m_times.at(ibin) - m_times.at(uint16_t(ibin - 1)));
-  float a = m_samples.at(ibin) - m * m_times.at(ibin);
+  float m = (m_samples.at(ibin) - m_samples.at(uint16_t(ibin - 1))) / (GetTimes().at(ibin) - GetTimes().at(uint16_t(ibin - 1)));
+  float a = m_samples.at(ibin) - m * GetTimes().at(ibin);
 	return (value - a) / m;
 }
 
   float StandardWaveform::interpolateVoltage(uint16_t ibin, float time) const {
 
     /** v = mt + a */
-    float m = (m_samples.at(ibin) - m_samples.at(uint16_t(ibin - 1))) / (m_times.at(ibin) - m_times.at(uint16_t(ibin - 1)));
-    float a = m_samples.at(ibin) - m * m_times.at(ibin);
+    float m = (m_samples.at(ibin) - m_samples.at(uint16_t(ibin - 1))) / (GetTimes().at(ibin) - GetTimes().at(uint16_t(ibin - 1)));
+    float a = m_samples.at(ibin) - m * GetTimes().at(ibin);
     return m * time + a;
   }
 
@@ -169,8 +170,8 @@ float StandardWaveform::getRiseTime(uint16_t bin_low, uint16_t bin_high, float n
 
   uint16_t max_index = getIndex(bin_low, bin_high, m_polarity);
   float max_value = m_samples.at(max_index) - noise;
-  float t_start = m_times.at(bin_low);
-  float t_stop = m_times.at(uint16_t(max_index - 1));
+  float t_start = GetTimes().at(bin_low);
+  float t_stop = GetTimes().at(uint16_t(max_index - 1));
   bool found_stop(false);
   for (uint16_t i(max_index); i > bin_low; i--) {
     if (fabs(m_samples.at(i) - noise) < std::fabs(max_value) * .8 and not found_stop) {
@@ -188,8 +189,8 @@ float StandardWaveform::getRiseTime(uint16_t bin_low, uint16_t bin_high, float n
 float StandardWaveform::getFallTime(uint16_t bin_low, uint16_t bin_high, float noise) const {
 
   uint16_t max_index = getIndex(bin_low, bin_high, m_polarity);
-  float t_start = m_times.at(uint16_t(max_index + 1));
-  float t_stop = m_times.at(bin_high);
+  float t_start = GetTimes().at(uint16_t(max_index + 1));
+  float t_stop = GetTimes().at(bin_high);
   float max_value = m_samples.at(max_index) - noise;
   bool found_start(false);
   for (uint16_t i(max_index); i < bin_high; i++) {
@@ -213,8 +214,8 @@ float StandardWaveform::getWFStartTime(uint16_t bin_low, uint16_t bin_high, floa
   float max = std::fabs(max_value) - noise;
   for (uint16_t i(max_index); i > bin_low; i--)
     if (max * .2 <= fabs(m_samples.at(i) - noise) and fabs(m_samples.at(i) - noise) <= max * .8)
-      g.SetPoint(i_point++, m_times.at(i), m_samples.at(i));
-  TF1 fit("fit", "pol1", m_times.at(bin_low), m_times.at(bin_high));
+      g.SetPoint(i_point++, GetTimes().at(i), m_samples.at(i));
+  TF1 fit("fit", "pol1", GetTimes().at(bin_low), GetTimes().at(bin_high));
   g.Fit(&fit, "q");
   return float(fit.GetX(noise));
 }
@@ -225,22 +226,73 @@ std::pair<float, float> StandardWaveform::fitMaximum(uint16_t bin_low, uint16_t
 	TF1 fit("landau", "landau + [3]");
 	uint16_t max_index = getIndex(bin_low, bin_high, m_polarity);
 	for (auto i(uint16_t(max_index - 6)); i <= max_index + 6; i++)
-		gr.SetPoint(i - max_index + 6, m_times.at(i), m_samples.at(i));
-	fit.SetParameters(m_polarity * 300, m_times.at(max_index), 2, 0);
+		gr.SetPoint(i - max_index + 6, GetTimes().at(i), m_samples.at(i));
+	fit.SetParameters(m_polarity * 300, GetTimes().at(max_index), 2, 0);
 	gr.Fit(&fit, "q");
 	return make_pair(fit.GetParameter(1), fit(fit.GetParameter(1)));
 }
 
+float StandardWaveform::getWFStartTimeLinear(uint16_t bin_low, uint16_t bin_high, float noise, float max_value) const {
+
+  const std::vector<float> & t = GetTimes();
+  uint16_t max_index = getIndex(bin_low, bin_high, m_polarity);
+  float max = std::fabs(max_value) - noise;
+  // same points as in getWFStartTime, times relative to the maximum to keep the sums well conditioned
+  double t0 = t.at(max_index), n(0), st(0), sv(0), stt(0), stv(0);
+  for (uint16_t i(max_index); i > bin_low; i--) {
+    float v = m_samples.at(i);
+    if (max * .2 <= fabs(v - noise) and fabs(v - noise) <= max * .8) {
+      double dt = t[i] - t0;
+      n++; st += dt; sv += v; stt += dt * dt; stv += dt * v;
+    }
+  }
+  double det = n * stt - st * st;
+  double m = det != 0 ? (n * stv - st * sv) / det : 0;
+  if (m == 0)
+    return t.at(bin_low);
+  double a = (sv - m * st) / n;
+  // the pol1 fit result is only searched inside the fit range
+  return float(std::min(std::max(t0 + (noise - a) / m, double(t.at(bin_low))), double(t.at(bin_high))));
+}
+
+std::pair<float, float> StandardWaveform::interpolateMaximum(uint16_t bin_low, uint16_t bin_high, bool gauss) const {
+
+  const std::vector<float> & t = GetTimes();
+  uint16_t i = getIndex(bin_low, bin_high, m_polarity);
+  if (i == 0 or i + 1 >= m_samples.size())
+    return make_pair(t.at(i), m_samples.at(i));
+  double y0 = m_samples[i - 1], y1 = m_samples[i], y2 = m_samples[i + 1];
+  gauss = gauss and m_polarity * y0 > 0 and m_polarity * y1 > 0 and m_polarity * y2 > 0;
+  if (gauss) {
+    y0 = log(m_polarity * y0); y1 = log(m_polarity * y1); y2 = log(m_polarity * y2);
+  }
+  // y = y1 + b * d + a * d^2 with d = t - t[i], the bins are not equidistant
+  double d0 = t[i - 1] - t[i], d2 = t[i + 1] - t[i];
+  double a = ((y2 - y1) / d2 - (y0 - y1) / d0) / (d2 - d0);
+  double b = (y0 - y1) / d0 - a * d0;
+  if (a == 0)
+    return make_pair(t[i], m_samples[i]);
+  double d = std::min(std::max(-b / (2 * a), d0), d2);
+  double y = y1 + b * d + a * d * d;
+  return make_pair(float(t[i] + d), float(gauss ? m_polarity * exp(y) : y));
+}
+
 float StandardWaveform::getTriggerTime(std::vector<float> * tcal) const {
 
-  float min = calc_mean(std::vector<float>(m_samples.begin() + 5, m_samples.begin() + 15)).first;
-  float max = calc_mean(std::vector<float>(m_samples.end() - 15, m_samples.end() - 5)).first;
+  float min = float(std::accumulate(m_samples.begin() + 5, m_samples.begin() + 15, 0.0) / float(10));
+  float max = float(std::accumulate(m_samples.end() - 15, m_samples.end() - 5, 0.0) / float(10));
   float half = (max + min) / 2;
   std::pair<float, float> p1, p2;
+  // running sum of the calibrated times as in getCalibratedTimes(), without building the vector
+  float t_prev = tcal->at(m_trigger_cell), t = t_prev;
+  for (uint16_t i(1); i < 5 && i < m_n_samples; i++)
+    t = tcal->at(unsigned((m_trigger_cell + i) % m_n_samples)) + t;
   for (uint16_t i(5); i < m_n_samples; i++){
+    t_prev = t;
+    t = tcal->at(unsigned((m_trigger_cell + i) % m_n_samples)) + t;
     if (m_samples.at(i) > half){
-      p1 = std::make_pair(getCalibratedTimes(tcal).at(uint16_t(i - 1)), m_samples.at(uint16_t(i - 1)));
-      p2 = std::make_pair(getCalibratedTimes(tcal).at(i), m_samples.at(i));
+      p1 = std::make_pair(t_prev, m_samples.at(uint16_t(i - 1)));
+      p2 = std::make_pair(t, m_samples.at(i));
       break;
     }
   }
@@ -251,15 +303,15 @@ float StandardWaveform::getTriggerTime(std::vector<float> * tcal) const {
 }
 
 std::pair<uint16_t, float> StandardWaveform::getMaxPeak() const {
-    auto max = std::max_element(m_samples.begin(), m_samples.end());
-    auto min = std::min_element(m_samples.begin(), m_samples.end());
-    auto peak = (abs(int(*max)) > abs(int(*min))) ? max : min;
-    return std::make_pair(uint16_t(std::distance(m_samples.begin(), peak)), *peak);
+    size_t max = waveform::ArgMax(m_samples.data(), m_samples.size());
+    size_t min = waveform::ArgMin(m_samples.data(), m_samples.size());
+    size_t peak = (abs(int(m_samples[max])) > abs(int(m_samples[min]))) ? max : min;
+    return std::make_pair(uint16_t(peak), m_samples[peak]);
 }
 
-std::vector<uint16_t> * StandardWaveform::getAllPeaksAbove(uint16_t min, uint16_t max, float threshold) const {
+void StandardWaveform::getAllPeaksAbove(uint16_t min, uint16_t max, float threshold, std::vector<uint16_t> & peak_positions) const {
 
-	std::vector<uint16_t> * peak_positions = new std::vector<uint16_t>;
+  peak_positions.clear();
   uint16_t low(0), high;
 
 	for (uint16_t j = uint16_t(min + 1); j <= max - 1; j++){
@@ -272,55 +324,60 @@ std::vector<uint16_t> * StandardWaveform::getAllPeaksAbove(uint16_t min, uint16_
       high = j;
       // the peak has to have a certain width -> avoid spikes
       if (high > low + 5){
-        auto min = std::min_element(m_samples.begin() + low, m_samples.begin() + high);
-        auto max = std::max_element(m_samples.begin() + low, m_samples.begin() + high);
-        auto peak = (std::abs((*max)) > std::abs(*min)) ? max : min;
-        uint16_t pos = uint16_t(std::distance(m_samples.begin(), peak));
-        if (not peak_positions->size())
-          peak_positions->push_back(pos);
+        uint16_t min = getIndexMin(low, high);
+        uint16_t max = getIndexMax(low, high);
+        uint16_t pos = (std::abs(m_samples[max]) > std::abs(m_samples[min])) ? max : min;
+        if (not peak_positions.size())
+          peak_positions.push_back(pos);
           // value has to be at least in the next bunch
-        else if (pos > peak_positions->back() + 35)
-          peak_positions->push_back(pos);
+        else if (pos > peak_positions.back() + 35)
+          peak_positions.push_back(pos);
       }
     }
   }
-	return peak_positions;
 }
 
 float StandardWaveform::getMedian(uint32_t min, uint32_t max) const
 {
-    float median;
+    // the scratch buffer only grows, so there is no allocation per call once it has the waveform size
+    static thread_local std::vector<float> scratch;
     int n = max >= min ? max - min + 1 : min - max + 1;
-    median = (float)TMath::Median(n, &m_samples.at(min));
-    return median;
+    return waveform::Median(&m_samples.at(min), size_t(n), scratch);
 }
 
   float StandardWaveform::getCFT(uint16_t min, uint16_t max, uint8_t delay, float factor) const {
     /** subtract the delayed and reduced waveform and find the zero crossing point */
-    vector<float> v0(m_samples.begin() + min, m_samples.begin() + max);
+    // no two samples to interpolate between, NaN so that the event fails the timing cuts
+    if (max < min + 2) return std::numeric_limits<float>::quiet_NaN();
     bool last_is_neg = false;
     uint8_t i_cross = 1;
+    float v_last = 0, v = 0, v_cross_low = 0, v_cross = 0;
     for (uint8_t i(0); i < uint8_t(max - min); i++) {
-      v0.at(i) = float(m_polarity) * (v0.at(i) - m_samples.at(min + i + delay) * factor);
-      if (i > 0 and last_is_neg and v0.at(i) > 0){  // find zero crossing
+      v = float(m_polarity) * (m_samples[min + i] - m_samples.at(min + i + delay) * factor);
+      if (i == 1) { v_cross_low = v_last; v_cross = v; }
+      if (i > 0 and last_is_neg and v > 0){  // find zero crossing
         i_cross = i;
+        v_cross_low = v_last;
+        v_cross = v;
         break; }
-      last_is_neg = v0.at(i) < 0; }
-    return interpolate_x(m_times.at(i_cross + min - 1), m_times.at(i_cross + min), v0.at(i_cross - 1), v0.at(i_cross), 0);
+      last_is_neg = v < 0;
+      v_last = v; }
+    return interpolate_x(GetTimes().at(i_cross + min - 1), GetTimes().at(i_cross + min), v_cross_low, v_cross, 0);
   }
 
 /************************************************************************************************/
 /*************************************** Standard Plane *****************************************/
 /************************************************************************************************/
 
-StandardPlane::StandardPlane() : m_id(0), m_tluevent(0), m_xsize(0), m_ysize(0), m_flags(0), m_pivotpixel(0), m_result_pix(0), m_result_x(0), m_result_y(0) {}
+StandardPlane::StandardPlane() : m_id(0), m_tluevent(0), m_xsize(0), m_ysize(0), m_flags(0), m_pivotpixel(0), m_result_pix(0), m_result_x(0), m_result_y(0),
+  m_compact_done(false) {}
 
 StandardPlane::StandardPlane(unsigned id, const std::string & type, const std::string & sensor)
 : m_type(type), m_sensor(sensor), m_id(id), m_tluevent(0), m_xsize(0), m_ysize(0),
-  m_flags(0), m_pivotpixel(0), m_result_pix(0), m_result_x(0), m_result_y(0)
+  m_flags(0), m_pivotpixel(0), m_result_pix(0), m_result_x(0), m_result_y(0), m_compact_done(false)
 {}
 
-StandardPlane::StandardPlane(Deserializer & ds) : m_result_pix(0), m_result_x(0), m_result_y(0) {
+StandardPlane::StandardPlane(Deserializer & ds) : m_result_pix(0), m_result_x(0), m_result_y(0), m_compact_done(false) {
 	ds.read(m_type);
 	ds.read(m_sensor);
 	ds.read(m_id);
@@ -336,6 +393,55 @@ StandardPlane::StandardPlane(Deserializer & ds) : m_result_pix(0), m_result_x(0)
 	ds.read(m_mat);
 }
 
+StandardPlane::StandardPlane(const StandardPlane & other)
+: m_type(other.m_type), m_sensor(other.m_sensor), m_id(other.m_id), m_tluevent(other.m_tluevent),
+  m_xsize(other.m_xsize), m_ysize(other.m_ysize), m_flags(other.m_flags), m_pivotpixel(other.m_pivotpixel),
+  m_trigger_count(other.m_trigger_count), m_trigger_phase(other.m_trigger_phase),
+  m_pix(other.m_pix), m_x(other.m_x), m_y(other.m_y), m_pivot(other.m_pivot), m_mat(other.m_mat),
+  m_result_pix(0), m_result_x(0), m_result_y(0), m_compact_done(false)
+{
+	if (IsCompact()) m_compact = other.m_compact;
+}
+
+StandardPlane::StandardPlane(StandardPlane && other)
+: m_type(std::move(other.m_type)), m_sensor(std::move(other.m_sensor)), m_id(other.m_id), m_tluevent(other.m_tluevent),
+  m_xsize(other.m_xsize), m_ysize(other.m_ysize), m_flags(other.m_flags), m_pivotpixel(other.m_pivotpixel),
+  m_trigger_count(other.m_trigger_count), m_trigger_phase(other.m_trigger_phase),
+  m_pix(std::move(other.m_pix)), m_x(std::move(other.m_x)), m_y(std::move(other.m_y)), m_pivot(std::move(other.m_pivot)),
+  m_mat(std::move(other.m_mat)), m_result_pix(0), m_result_x(0), m_result_y(0), m_compact_done(false)
+{
+	if (IsCompact()) m_compact = std::move(other.m_compact);
+	other.ResetResult();
+}
+
+StandardPlane & StandardPlane::operator=(StandardPlane other) {
+	m_type.swap(other.m_type);
+	m_sensor.swap(other.m_sensor);
+	m_id = other.m_id;
+	m_tluevent = other.m_tluevent;
+	m_xsize = other.m_xsize;
+	m_ysize = other.m_ysize;
+	m_flags = other.m_flags;
+	m_pivotpixel = other.m_pivotpixel;
+	m_trigger_count = other.m_trigger_count;
+	m_trigger_phase = other.m_trigger_phase;
+	m_pix.swap(other.m_pix);
+	m_x.swap(other.m_x);
+	m_y.swap(other.m_y);
+	m_pivot.swap(other.m_pivot);
+	m_mat.swap(other.m_mat);
+	m_compact = std::move(other.m_compact);
+	ResetResult();
+	return *this;
+}
+
+/** Forgets the results built by SetupResult and Compact, after the pixels changed */
+void StandardPlane::ResetResult() {
+	m_result_pix = 0;
+	m_result_x = m_result_y = 0;
+	m_compact_done = false;
+}
+
 void StandardPlane::Serialize(Serializer & ser) const {
 	ser.write(m_type);
 	ser.write(m_sensor);
@@ -343,6 +449,17 @@ void StandardPlane::Serialize(Serializer & ser) const {
 	ser.write(m_tluevent);
 	ser.write(m_xsize);
 	ser.write(m_ysize);
+	if (IsCompact()) {
+		// written as an ordinary single frame plane, so that the format does not change
+		ser.write(m_flags & ~unsigned(FLAG_COMPACT));
+		ser.write(m_pivotpixel);
+		ser.write(std::vector<std::vector<pixel_t> >(1, std::vector<pixel_t>(m_compact.pix.begin(), m_compact.pix.end())));
+		ser.write(std::vector<std::vector<coord_t> >(1, std::vector<coord_t>(m_compact.x.begin(), m_compact.x.end())));
+		ser.write(std::vector<std::vector<coord_t> >(1, std::vector<coord_t>(m_compact.y.begin(), m_compact.y.end())));
+		ser.write(m_pivot);
+		ser.write(m_mat);
+		return;
+	}
 	ser.write(m_flags);
 	ser.write(m_pivotpixel);
 	ser.write(m_pix);
@@ -360,7 +477,7 @@ void StandardPlane::Serialize(Serializer & ser) const {
 
 void StandardPlane::Print(std::ostream & os) const {
 	os << m_id << ", " << m_type << ":" << m_sensor << ", " << m_xsize << "x" << m_ysize << "x" << m_pix.size()
-    				  << " (" << (m_pix.size() ? m_pix[0].size() : 0) << "), tlu=" << m_tluevent << ", pivot=" << m_pivotpixel;
+    				  << " (" << (m_pix.size() ? HitPixels(0) : 0) << "), tlu=" << m_tluevent << ", pivot=" << m_pivotpixel;
 }
 
 void StandardPlane::SetSizeRaw(unsigned w, unsigned h, unsigned frames, int flags) {
@@ -374,6 +491,13 @@ void StandardPlane::SetSizeZS(unsigned w, unsigned h, unsigned npix, unsigned fr
 	//std::cout << "DBG flags " << hexdec(m_flags) << std::endl;
 	m_xsize = w;
 	m_ysize = h;
+	ResetResult();
+	if (IsCompact()) {
+		if (frames != 1 or GetFlags(FLAG_NEEDCDS | FLAG_ACCUMULATE | FLAG_WITHPIVOT | FLAG_WITHSUBMAT | FLAG_DIFFCOORDS))
+			EUDAQ_THROW("Compact planes need a single frame without CDS, pivot or submatrix");
+		m_compact.resize(npix);
+		npix = 0;
+	}
 	m_pix.resize(frames);
 	m_x.resize(GetFlags(FLAG_DIFFCOORDS) ? frames : 1);
 	m_y.resize(GetFlags(FLAG_DIFFCOORDS) ? frames : 1);
@@ -390,6 +514,13 @@ void StandardPlane::SetSizeZS(unsigned w, unsigned h, unsigned npix, unsigned fr
 
 void StandardPlane::PushPixelHelper(unsigned x, unsigned y, double p, bool pivot, unsigned frame) {
 	if (frame > m_x.size()) EUDAQ_THROW("Bad frame number " + to_string(frame) + " in PushPixel");
+	ResetResult();
+	if (IsCompact()) {
+		m_compact.x.push_back(uint16_t(x));
+		m_compact.y.push_back(uint16_t(y));
+		m_compact.pix.push_back(float(p));
+		return;
+	}
 	m_x[frame].push_back(x);
 	m_y[frame].push_back(y);
 	m_pix[frame].push_back(p);
@@ -399,6 +530,13 @@ void StandardPlane::PushPixelHelper(unsigned x, unsigned y, double p, bool pivot
 
 void StandardPlane::SetPixelHelper(unsigned index, unsigned x, unsigned y, double pix, bool pivot, unsigned frame) {
 	if (frame >= m_pix.size()) EUDAQ_THROW("Bad frame number " + to_string(frame) + " in SetPixel");
+	ResetResult();
+	if (IsCompact()) {
+		m_compact.x.at(index) = uint16_t(x);
+		m_compact.y.at(index) = uint16_t(y);
+		m_compact.pix.at(index) = float(pix);
+		return;
+	}
 	if (frame < m_x.size()) m_x.at(frame).at(index) = x;
 	if (frame < m_y.size()) m_y.at(frame).at(index) = y;
 	if (frame < m_pivot.size()) m_pivot.at(frame).at(index) = pivot;
@@ -406,29 +544,37 @@ void StandardPlane::SetPixelHelper(unsigned index, unsigned x, unsigned y, doubl
 }
 
 void StandardPlane::SetFlags(StandardPlane::FLAGS flags) {
+	if (flags & FLAG_COMPACT) EUDAQ_THROW("FLAG_COMPACT has to be given to SetSizeZS");
 	m_flags |= flags;
+	ResetResult();
 }
 
 double StandardPlane::GetPixel(unsigned index, unsigned frame) const {
+	if (IsCompact() and frame == 0) return m_compact.pix.at(index);
 	return m_pix.at(frame).at(index);
 }
 double StandardPlane::GetPixel(unsigned index) const {
+	if (IsCompact()) return m_compact.pix.at(index);
 	SetupResult();
 	return m_result_pix->at(index);
 }
 double StandardPlane::GetX(unsigned index, unsigned frame) const {
+	if (IsCompact() and frame == 0) return m_compact.x.at(index);
 	if (!GetFlags(FLAG_DIFFCOORDS)) frame = 0;
 	return m_x.at(frame).at(index);
 }
 double StandardPlane::GetX(unsigned index) const {
+	if (IsCompact()) return m_compact.x.at(index);
 	SetupResult();
 	return m_result_x->at(index);
 }
 double StandardPlane::GetY(unsigned index, unsigned frame) const {
+	if (IsCompact() and frame == 0) return m_compact.y.at(index);
 	if (!GetFlags(FLAG_DIFFCOORDS)) frame = 0;
 	return m_y.at(frame).at(index);
 }
 double StandardPlane::GetY(unsigned index) const {
+	if (IsCompact()) return m_compact.y.at(index);
 	SetupResult();
 	return m_result_y->at(index);
 }
@@ -439,9 +585,11 @@ bool StandardPlane::GetPivot(unsigned index, unsigned frame) const {
 
 void StandardPlane::SetPivot(unsigned index, unsigned frame , bool PivotFlag) {
 	m_pivot.at(frame).at(index) = PivotFlag;
+	ResetResult();
 }
 
 const std::vector<StandardPlane::coord_t> & StandardPlane::XVector(unsigned frame) const {
+	if (IsCompact() and frame == 0) return XVector();
 	return GetFrame(m_x, frame);
 }
 
@@ -451,6 +599,7 @@ const std::vector<StandardPlane::coord_t> & StandardPlane::XVector() const {
 }
 
 const std::vector<StandardPlane::coord_t> & StandardPlane::YVector(unsigned frame) const {
+	if (IsCompact() and frame == 0) return YVector();
 	return GetFrame(m_y, frame);
 }
 
@@ -460,6 +609,7 @@ const std::vector<StandardPlane::coord_t> & StandardPlane::YVector() const {
 }
 
 const std::vector<StandardPlane::pixel_t> & StandardPlane::PixVector(unsigned frame) const {
+	if (IsCompact() and frame == 0) return PixVector();
 	return GetFrame(m_pix, frame);
 }
 
@@ -468,6 +618,19 @@ const std::vector<StandardPlane::pixel_t> & StandardPlane::PixVector() const {
 	return *m_result_pix;
 }
 
+const StandardPlane::CompactPixels & StandardPlane::Compact() const {
+	if (IsCompact() or m_compact_done) return m_compact;
+	SetupResult();
+	m_compact.resize(m_result_pix->size());
+	for (size_t i = 0; i < m_compact.size(); ++i) {
+		m_compact.x[i] = uint16_t((*m_result_x)[i]);
+		m_compact.y[i] = uint16_t((*m_result_y)[i]);
+		m_compact.pix[i] = float((*m_result_pix)[i]);
+	}
+	m_compact_done = true;
+	return m_compact;
+}
+
 void StandardPlane::SetXSize(unsigned x) {
 	m_xsize = x;
 }
@@ -513,10 +676,12 @@ unsigned StandardPlane::TotalPixels() const {
 }
 
 unsigned StandardPlane::HitPixels(unsigned frame) const {
+	if (IsCompact() and frame == 0) return m_compact.size();
 	return GetFrame(m_pix, frame).size();
 }
 
 unsigned StandardPlane::HitPixels() const {
+	if (IsCompact()) return m_compact.size();
 	SetupResult();
 	return m_result_pix->size();
 }
@@ -559,7 +724,14 @@ void StandardPlane::SetupResult() const {
 	if (m_result_pix) return;
 	m_result_x = &m_x[0];
 	m_result_y = &m_y[0];
-	if (GetFlags(FLAG_ACCUMULATE)) {
+	if (IsCompact()) {
+		m_temp_x.assign(m_compact.x.begin(), m_compact.x.end());
+		m_temp_y.assign(m_compact.y.begin(), m_compact.y.end());
+		m_temp_pix.assign(m_compact.pix.begin(), m_compact.pix.end());
+		m_result_x = &m_temp_x;
+		m_result_y = &m_temp_y;
+		m_result_pix = &m_temp_pix;
+	} else if (GetFlags(FLAG_ACCUMULATE)) {
 		m_temp_pix.resize(0);
 		m_temp_x.resize(0);
 		m_temp_y.resize(0);
@@ -721,6 +893,11 @@ StandardPlane & StandardEvent::AddPlane(const StandardPlane & plane) {
 	return m_planes.back();
 }
 
+StandardPlane & StandardEvent::AddPlane(StandardPlane && plane) {
+	m_planes.push_back(std::move(plane));
+	return m_planes.back();
+}
+
 
 //begin added CD
 size_t StandardEvent::NumTUEvents() const{
@@ -742,7 +919,7 @@ StandardTUEvent & StandardEvent::AddTUEvent(const StandardTUEvent & tuev){
 
 //end added CD
 
-bool StandardEvent::hasTUEvent() {
+bool StandardEvent::hasTUEvent() const {
 	return m_tuevent.size() !=0;
 }
 
@@ -759,5 +936,10 @@ StandardWaveform & StandardEvent::AddWaveform(const StandardWaveform & waveform)
 	return m_waveforms.back();
 }
 
+StandardWaveform & StandardEvent::AddWaveform(StandardWaveform && waveform) {
+	m_waveforms.push_back(std::move(waveform));
+	return m_waveforms.back();
+}
+
 } // end namespace eudaq
 
@@ -0,0 +1,27 @@
+#include "eudaq/TimeCalibration.hh"
+#include "eudaq/Exception.hh"
+
+namespace eudaq {
+
+  TimeCalibration::TimeCalibration(const std::vector<float> & tcal, uint16_t n_samples, bool build_axes) : m_n_samples(n_samples) {
+    if (n_samples == 0 || tcal.size() < n_samples) EUDAQ_THROW("Time calibration has " + to_string(tcal.size()) + " bins, expected " + to_string(n_samples));
+    m_full_time.reserve(2 * size_t(n_samples));
+    float sum = 0;
+    m_full_time.push_back(sum);
+    for (unsigned j = 0; j < 2u * n_samples - 1; j++) {
+      sum += tcal[j % n_samples];
+      m_full_time.push_back(sum);
+    }
+    if (!build_axes) return;
+    m_axes.reserve(n_samples);
+    for (unsigned cell = 0; cell < n_samples; cell++) {
+      std::vector<float> t;
+      t.reserve(n_samples);
+      t.push_back(tcal[cell]);
+      for (unsigned i = 1; i < n_samples; i++)
+        t.push_back(tcal[(cell + i) % n_samples] + t.back());
+      m_axes.push_back(std::make_shared<const std::vector<float> >(std::move(t)));
+    }
+  }
+
+}
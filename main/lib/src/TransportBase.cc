@@ -40,7 +40,7 @@ namespace eudaq {
       MutexLock m(m_mutex);
       if (m_events.empty()) break;
       //std::cout << "Got packet" << std::endl;
-      TransportEvent evt(m_events.front());
+      TransportEvent evt(std::move(m_events.front()));
       m_events.pop();
       m.Release();
       m_callback(evt);
@@ -66,7 +66,8 @@ namespace eudaq {
     bool ret = false;
     if (!m_events.empty() && conn.Matches(m_events.front().id)) {
       ret = true;
-      *packet = m_events.front().packet;
+      const TransportEvent & ev = m_events.front();
+      *packet = ev.view.empty() ? ev.packet : ev.view.str();
       m_events.pop();
     }
     //std::cout << "ReceivePacket() return " << (ret ? "true" : "false") << std::endl;
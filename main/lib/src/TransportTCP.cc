@@ -173,6 +173,11 @@ at some places we have constructions like:
 #include <sys/types.h>
 #include <errno.h>
 //#include <unistd.h>
+#if EUDAQ_PLATFORM_IS(LINUX)
+# include <sys/epoll.h>
+#endif
+#include <mutex>
+#include <climits>
 
 #include <iostream>
 #include <ostream>
@@ -185,11 +190,12 @@ namespace eudaq {
   namespace {
 
     static const int MAXPENDING = 16;
-    static const int MAX_BUFFER_SIZE = 10000;
-
-    static int to_int(char c) {
-      return static_cast<unsigned char>(c);
-    }
+    static const size_t CHUNK_SIZE = 256 << 10;     ///< default size of a receive chunk
+    static const size_t MIN_RECV_SIZE = 64 << 10;   ///< don't recv() into less free space than this
+    static const size_t MAX_POOLED_CHUNKS = 64;
+    static const size_t MAX_POOLED_SIZE = 64 << 20; ///< bigger chunks are freed instead of pooled
+    static const int SERVER_RCVBUF = 4 << 20;
+    static const int MAX_EPOLL_EVENTS = 64;
 
 #ifdef MSG_NOSIGNAL
     // On Linux (and cygwin?) send(...) can be told to
@@ -256,6 +262,43 @@ namespace eudaq {
       //if (length > 500000) std::cout << "Done send packet" << std::endl;
     }
 
+    /** Receive chunks are given back to the pool when the last view into them is gone,
+     *  which may happen in any thread. The pool is never destroyed, so it outlives all chunks. */
+    class ChunkPool {
+      public:
+        typedef std::vector<unsigned char> chunk_t;
+        static ChunkPool & Instance() {
+          static ChunkPool * pool = new ChunkPool;
+          return *pool;
+        }
+        std::shared_ptr<chunk_t> Get(size_t size) {
+          chunk_t * chunk = 0;
+          {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_free.empty()) {
+              chunk = m_free.back();
+              m_free.pop_back();
+            }
+          }
+          if (!chunk) chunk = new chunk_t;
+          if (chunk->size() < size) chunk->resize(size);
+          return std::shared_ptr<chunk_t>(chunk, [this](chunk_t * c) { Release(c); });
+        }
+      private:
+        void Release(chunk_t * chunk) {
+          if (chunk->size() <= MAX_POOLED_SIZE) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_free.size() < MAX_POOLED_CHUNKS) {
+              m_free.push_back(chunk);
+              return;
+            }
+          }
+          delete chunk;
+        }
+        std::mutex m_mutex;
+        std::vector<chunk_t *> m_free;
+    };
+
     //     static void send_data(SOCKET sock, uint32_t data) {
     //       std::string str;
     //       for (int i = 0; i < 4; ++i) {
@@ -279,47 +322,68 @@ namespace eudaq {
     os << " (" /*<< m_fd << ","*/ << m_host << ")";
   }
 
-  void ConnectionInfoTCP::append(size_t length, const char * data) {
-    m_buf += std::string(data, length);
-    update_length();
-    //std::cout << *this << " - append: " << m_len << ", " << m_buf.size() << std::endl;
+  size_t TCPReceiveBuffer::packetlength() const {
+    size_t len = 0;
+    for (int i = 0; i < 4; ++i) {
+      len |= size_t((*m_chunk)[m_begin + i]) << (8*i);
+    }
+    return len;
   }
 
-  bool ConnectionInfoTCP::havepacket() const {
-    return m_buf.length() >= m_len + 4;
+  unsigned char * TCPReceiveBuffer::reserve(size_t & avail) {
+    size_t used = m_end - m_begin;
+    // make room for more of the current packet, so that big events arrive in a few large recv() calls,
+    // but grow at most by the bytes actually received: the length prefix alone is not trusted
+    size_t need = MIN_RECV_SIZE;
+    if (used >= 4 && packetlength() + 4 > used) need = std::max(need, std::min(packetlength() + 4 - used, std::max(used, CHUNK_SIZE)));
+    if (!m_chunk) {
+      m_chunk = ChunkPool::Instance().Get(std::max(CHUNK_SIZE, need));
+    } else if (m_chunk->size() - m_end < need) {
+      if (m_chunk.use_count() == 1 && m_chunk->size() - used >= need) {
+        // nobody else looks at the chunk any more: move the unread rest to the front
+        if (used) std::memmove(&(*m_chunk)[0], &(*m_chunk)[m_begin], used);
+      } else {
+        std::shared_ptr<std::vector<unsigned char> > chunk = ChunkPool::Instance().Get(std::max(CHUNK_SIZE, used + need));
+        if (used) std::memcpy(&(*chunk)[0], &(*m_chunk)[m_begin], used);
+        m_chunk = chunk;
+      }
+      m_begin = 0;
+      m_end = used;
+    }
+    avail = m_chunk->size() - m_end;
+    return &(*m_chunk)[m_end];
   }
 
-  std::string ConnectionInfoTCP::getpacket() {
-    if (!havepacket()) EUDAQ_THROW_NOLOG("No packet available");
-    std::string packet(m_buf, 4, m_len);
-    m_buf.erase(0, m_len+4);
-    update_length(true);
-    //std::cout << *this << " - getpacket: " << m_len << ", " << m_buf.size() << std::endl;
-    return packet;
+  void TCPReceiveBuffer::append(size_t length, const char * data) {
+    while (length) {
+      size_t avail;
+      unsigned char * dest = reserve(avail);
+      size_t n = std::min(avail, length);
+      std::memcpy(dest, data, n);
+      commit(n);
+      data += n;
+      length -= n;
+    }
   }
 
-  void ConnectionInfoTCP::update_length(bool force) {
-    //std::cout << "DBG: len=" << m_len << ", buf=" << m_buf.length();
-    if (force || m_len == 0) {
-      m_len = 0;
-      if (m_buf.length() >= 4) {
-        for (int i = 0; i < 4; ++i) {
-          m_len |= to_int(m_buf[i]) << (8*i);
-        }
-        //         std::cout << " (" << to_hex(m_buf[3], 2)
-        //                   << " " << to_hex(m_buf[2], 2)
-        //                   << " " << to_hex(m_buf[1], 2)
-        //                   << " " << to_hex(m_buf[0], 2)
-        //                   << ")";
-      }
-    }
-    //std::cout << ", len=" << m_len << std::endl;
+  bool TCPReceiveBuffer::havepacket() const {
+    size_t used = m_end - m_begin;
+    return used >= 4 && used >= packetlength() + 4;
+  }
+
+  PacketView TCPReceiveBuffer::getview() {
+    if (!havepacket()) EUDAQ_THROW_NOLOG("No packet available");
+    size_t len = packetlength();
+    PacketView view(m_chunk, &(*m_chunk)[m_begin + 4], len);
+    m_begin += len + 4;
+    return view;
   }
 
   TCPServer::TCPServer(const std::string & param)
     : m_port(from_string(param, 44000)),
     m_srvsock(socket(PF_INET, SOCK_STREAM, IPPROTO_TCP)),
-    m_maxfd(m_srvsock)
+    m_maxfd(m_srvsock),
+    m_epfd(-1)
   {
     if (m_srvsock == (SOCKET)-1) EUDAQ_THROW_NOLOG(LastSockErrorString("Failed to create socket"));  //$$ check if (SOCKET)-1 is correct
     setup_signal();
@@ -334,6 +398,11 @@ namespace eudaq {
     addr.sin_addr.s_addr = htonl(INADDR_ANY);
     addr.sin_port = htons(m_port);
 
+#if EUDAQ_PLATFORM_IS(LINUX)
+    /// Let the kernel queue up a few MB, so producers sending big events don't stall on a full window.
+    /// Set before listen(), the accepted sockets inherit it and the window scale is negotiated with the SYN
+    setsockopt(m_srvsock, SOL_SOCKET, SO_RCVBUF, &SERVER_RCVBUF, sizeof SERVER_RCVBUF);
+#endif
     if (bind(m_srvsock, (sockaddr *) &addr, sizeof addr)) {
       closesocket(m_srvsock);
       EUDAQ_THROW_NOLOG(LastSockErrorString("Failed to bind socket: " + param));
@@ -342,6 +411,17 @@ namespace eudaq {
       closesocket(m_srvsock);
       EUDAQ_THROW_NOLOG(LastSockErrorString("Failed to listen on socket: " + param));
     }
+#if EUDAQ_PLATFORM_IS(LINUX)
+    m_epfd = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = m_srvsock;
+    if (m_epfd < 0 || epoll_ctl(m_epfd, EPOLL_CTL_ADD, m_srvsock, &ev)) {
+      closesocket(m_srvsock);
+      if (m_epfd >= 0) close(m_epfd);
+      EUDAQ_THROW_NOLOG(LastSockErrorString("Failed to set up epoll: " + param));
+    }
+#endif
   }
 
   TCPServer::~TCPServer() {
@@ -353,6 +433,9 @@ namespace eudaq {
       }
     }
     closesocket(m_srvsock);
+#if EUDAQ_PLATFORM_IS(LINUX)
+    close(m_epfd);
+#endif
   }
 
   ConnectionInfoTCP & TCPServer::GetInfo(SOCKET fd) const {
@@ -375,7 +458,7 @@ namespace eudaq {
         if (inf && inf->IsEnabled()) {
           SOCKET fd = inf->GetFd();
           inf->Disable();
-          FD_CLR(fd, &m_fdset);
+          Unwatch(fd);
           closesocket(fd);
         }
       }
@@ -397,6 +480,93 @@ namespace eudaq {
     }
   }
 
+  void TCPServer::Unwatch(SOCKET fd) {
+#if EUDAQ_PLATFORM_IS(LINUX)
+    epoll_ctl(m_epfd, EPOLL_CTL_DEL, fd, NULL);
+#else
+    FD_CLR(fd, &m_fdset);
+#endif
+  }
+
+  void TCPServer::Accept() {
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    SOCKET peersock = accept(static_cast<int>(m_srvsock), (sockaddr*)&addr, &len);
+    if (peersock == INVALID_SOCKET) {
+      std::cout << LastSockErrorString("Error in accept()") << std::endl;
+      return;
+    }
+    //std::cout << "Connect " << peersock << " from " << inet_ntoa(addr.sin_addr) << std::endl;
+#if EUDAQ_PLATFORM_IS(LINUX)
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = peersock;
+    if (epoll_ctl(m_epfd, EPOLL_CTL_ADD, peersock, &ev)) {
+      std::cout << LastSockErrorString("Error in epoll_ctl()") << std::endl;
+      closesocket(peersock);
+      return;
+    }
+#else
+    FD_SET(peersock, &m_fdset);
+#endif
+    m_maxfd = (m_maxfd < peersock) ? peersock : m_maxfd;
+    setup_socket(peersock);
+    std::string host = inet_ntoa(addr.sin_addr);
+    host += ":" + to_string(ntohs(addr.sin_port));
+    std::shared_ptr<ConnectionInfo> ptr(new ConnectionInfoTCP(peersock, host));
+    bool inserted = false;
+    for (size_t i = 0; i < m_conn.size(); ++i) {
+      if (m_conn[i]->GetState() < 0) {
+        m_conn[i] = ptr;
+        inserted = true;
+      }
+    }
+    if (!inserted) m_conn.push_back(ptr);
+    m_events.push(TransportEvent(TransportEvent::CONNECT, *ptr));
+  }
+
+  bool TCPServer::Receive(SOCKET fd) {
+    ConnectionInfoTCP & m = GetInfo(fd);
+    bool received = false;
+    for (;;) {
+      size_t avail;
+      unsigned char * buffer = m.reserve(avail);
+      int result;
+      do {
+        result = recv(fd, reinterpret_cast<char *>(buffer), static_cast<int>(std::min(avail, size_t(INT_MAX))), 0);
+      } while (result == EUDAQ_ERROR_NO_DATA_RECEIVED && LastSockError() == EUDAQ_ERROR_Interrupted_function_call);
+
+      if (result > 0) {
+        m.commit(result);
+        while (m.havepacket()) {
+          received = true;
+          if (m_packetviews && m.GetState() > 0)
+            m_events.push(TransportEvent(TransportEvent::RECEIVE, m, m.getview()));
+          else
+            m_events.push(TransportEvent(TransportEvent::RECEIVE, m, m.getpacket()));
+        }
+        if (size_t(result) < avail) break; // socket drained
+      }
+      else if (result == 0) {
+        debug_transport( "Server #%d, return=%d, WSAError:%d (%s) Disconnected.\n", fd, result, errno, strerror(errno));
+        m_events.push(TransportEvent(TransportEvent::DISCONNECT, m));
+        m.Disable();
+        Unwatch(fd);
+        closesocket(fd);
+        break;
+      }
+      else if (result == EUDAQ_ERROR_NO_DATA_RECEIVED) {
+        debug_transport( "Server #%d, return=%d, WSAError:%d (%s) No Data Received.\n", fd, result, errno, strerror(errno));
+        break;
+      }
+      else {
+        debug_transport( "Server #%d, return=%d, WSAError:%d (%s) \n", fd, result, errno, strerror(errno));
+        break;
+      }
+    }
+    return received;
+  }
+
   void TCPServer::ProcessEvents(int timeout) {
     //std::cout << "DEBUG: Process..." << std::endl;
 #if DEBUG_NOTIMEOUT == 0
@@ -405,81 +575,39 @@ namespace eudaq {
     Time t_remain = Time(0, timeout);
     bool done = false;
     do {
+#if EUDAQ_PLATFORM_IS(LINUX)
+      epoll_event events[MAX_EPOLL_EVENTS];
+      timeval remain = t_remain;
+      int ms = static_cast<int>(remain.tv_sec * 1000 + (remain.tv_usec + 999) / 1000);
+      int result = epoll_wait(m_epfd, events, MAX_EPOLL_EVENTS, ms);
+      if (result < 0 && LastSockError() != EUDAQ_ERROR_Interrupted_function_call) {
+        std::cout << LastSockErrorString("Error in epoll_wait()") << std::endl;
+      }
+      for (int i = 0; i < result; ++i) {
+        if (events[i].data.fd == m_srvsock) Accept();
+        else if (Receive(events[i].data.fd)) done = true;
+      }
+#else
       fd_set tempset;
       memcpy(&tempset, &m_fdset, sizeof(tempset));
       //std::cout << "select timeout=" << t_remain << std::endl;
       timeval timeremain = t_remain;
       int result = select(static_cast<int>(m_maxfd + 1), &tempset, NULL, NULL, &timeremain);
 
-
-      //std::cout << "select done" << std::endl;
-
       if (result == 0) {
         //std::cout << "timeout" << std::endl;
       } else if (result < 0 && LastSockError() != EUDAQ_ERROR_Interrupted_function_call) {
         std::cout << LastSockErrorString("Error in select()") << std::endl;
       } else if (result > 0) {
-
         if (FD_ISSET(m_srvsock, &tempset)) {
-          sockaddr_in addr;
-          socklen_t len = sizeof(addr);
-          SOCKET peersock = accept(static_cast<int>(m_srvsock), (sockaddr*)&addr, &len);
-          if (peersock == INVALID_SOCKET) {
-            std::cout << LastSockErrorString("Error in accept()") << std::endl;
-          } else {
-            //std::cout << "Connect " << peersock << " from " << inet_ntoa(addr.sin_addr) << std::endl;
-            FD_SET(peersock, &m_fdset);
-            m_maxfd = (m_maxfd < peersock) ? peersock : m_maxfd;
-            setup_socket(peersock);
-            std::string host = inet_ntoa(addr.sin_addr);
-            host += ":" + to_string(ntohs(addr.sin_port));
-            std::shared_ptr<ConnectionInfo> ptr(new ConnectionInfoTCP(peersock, host));
-            bool inserted = false;
-            for (size_t i = 0; i < m_conn.size(); ++i) {
-              if (m_conn[i]->GetState() < 0) {
-                m_conn[i] = ptr;
-                inserted = true;
-              }
-            }
-            if (!inserted) m_conn.push_back(ptr);
-            m_events.push(TransportEvent(TransportEvent::CONNECT, *ptr));
-            FD_CLR(m_srvsock, &tempset);
-          }
+          Accept();
+          FD_CLR(m_srvsock, &tempset);
         }
         for (SOCKET j=0; j < m_maxfd+1; j++) {
-          if (FD_ISSET(j, &tempset)) {
-            char buffer[MAX_BUFFER_SIZE+1];
-
-            do {
-              result = recv(j, buffer, MAX_BUFFER_SIZE, 0);
-            } while (result == EUDAQ_ERROR_NO_DATA_RECEIVED && LastSockError() == EUDAQ_ERROR_Interrupted_function_call);
-
-            if (result > 0) {
-              buffer[result] = 0;
-              ConnectionInfoTCP & m = GetInfo(j);
-              m.append(result, buffer);
-              while (m.havepacket()) {
-                done = true;
-                m_events.push(TransportEvent(TransportEvent::RECEIVE, m, m.getpacket()));
-              }
-            } //else /*if (result == 0)*/ {
-            else if (result == 0){
-              debug_transport( "Server #%d, return=%d, WSAError:%d (%s) Disconnected.\n", j, result, errno, strerror(errno));
-              ConnectionInfoTCP & m = GetInfo(j);
-              m_events.push(TransportEvent(TransportEvent::DISCONNECT, m));
-              m.Disable();
-              closesocket(j);
-              FD_CLR(j, &m_fdset);
-            }
-            else if (result == EUDAQ_ERROR_NO_DATA_RECEIVED ){
-              debug_transport( "Server #%d, return=%d, WSAError:%d (%s) No Data Received.\n", j, result, errno, strerror(errno));
-            }
-	    else {
-	      debug_transport( "Server #%d, return=%d, WSAError:%d (%s) \n", j, result, errno, strerror(errno));
-	    }
-          } // end if (FD_ISSET(j, &amp;tempset))
-          } // end for (j=0;...)
-        } // end else if (result > 0)
+          if (FD_ISSET(j, &tempset) && Receive(j)) done = true;
+        }
+      }
+#endif
 
 //optionally disable timeout at compile time by setting DEBUG_NOTIMEOUT to 1
 #if DEBUG_NOTIMEOUT
@@ -574,10 +702,11 @@ namespace eudaq {
 
         bool donereading = false;
         do {
-          char buffer[MAX_BUFFER_SIZE+1];
+          size_t avail;
+          unsigned char * buffer = m_buf.reserve(avail);
 
           do {
-            result = recv(m_sock, buffer, MAX_BUFFER_SIZE, 0);
+            result = recv(m_sock, reinterpret_cast<char *>(buffer), static_cast<int>(std::min(avail, size_t(INT_MAX))), 0);
           } while (result == EUDAQ_ERROR_NO_DATA_RECEIVED && LastSockError() == EUDAQ_ERROR_Interrupted_function_call);
 
           if (result == EUDAQ_ERROR_NO_DATA_RECEIVED && LastSockError() == EUDAQ_ERROR_Resource_temp_unavailable) {
@@ -593,7 +722,7 @@ namespace eudaq {
             EUDAQ_THROW_NOLOG(LastSockErrorString("SocketClient Error (" + to_string(LastSockError()) + ")"));
           }
           else if (result > 0){
-            m_buf.append(result, buffer);
+            m_buf.commit(result);
             while (m_buf.havepacket()) {
               m_events.push(TransportEvent(TransportEvent::RECEIVE, m_buf, m_buf.getpacket()));
               done = true;
@@ -615,6 +744,11 @@ namespace eudaq {
       //std::cout << "done" << std::endl;
     }
 
+    void TCPClient::SetNoDelay(bool nodelay) {
+      int flag = nodelay;
+      setsockopt(m_sock, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&flag), sizeof flag);
+    }
+
     TCPClient::~TCPClient() {
       closesocket(m_sock);
     }
@@ -0,0 +1,126 @@
+#include "eudaq/WaveformFFT.hh"
+#include "eudaq/WaveformKernels.hh"
+#include "eudaq/Logger.hh"
+#include "eudaq/Utils.hh"
+
+#include <map>
+#include <mutex>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#ifdef FFTW_FOUND
+#  include <fftw3.h>
+#endif
+#include "TVirtualFFT.h"
+
+namespace eudaq {
+
+  namespace {
+    /** the FFTW planner and the creation of TVirtualFFTs are not thread safe */
+    std::mutex & PlanMutex() {
+      static std::mutex mutex;
+      return mutex;
+    }
+    std::string & WisdomFile() {
+      static std::string path;
+      return path;
+    }
+#ifdef FFTW_FOUND
+    /** plans by (channels, samples), shared by all instances since executing a plan on new arrays is thread safe */
+    std::map<std::pair<size_t, size_t>, fftwf_plan> & Plans() {
+      static std::map<std::pair<size_t, size_t>, fftwf_plan> plans;
+      return plans;
+    }
+#endif
+  }
+
+  WaveformFFT::WaveformFFT() : m_n_channels(0), m_n(0), m_dist(0), m_buffer(0), m_plan(0), m_root_fft(0) {}
+
+  WaveformFFT::~WaveformFFT() {
+    Free();
+    delete m_root_fft;
+  }
+
+  void WaveformFFT::Free() {
+#ifdef FFTW_FOUND
+    fftwf_free(m_buffer);
+#else
+    delete [] m_buffer;
+#endif
+    m_buffer = 0;
+  }
+
+  void WaveformFFT::SetWisdomFile(const std::string & path) {
+    std::unique_lock<std::mutex> lock(PlanMutex());
+    WisdomFile() = path;
+#ifdef FFTW_FOUND
+    if (!path.empty() && std::ifstream(path.c_str()).good() && !fftwf_import_wisdom_from_filename(path.c_str()))
+      EUDAQ_WARN("Could not read the FFTW wisdom from " + path);
+#endif
+  }
+
+  void WaveformFFT::Resize(size_t n_channels, size_t n) {
+    if (n_channels == m_n_channels && n == m_n) return;
+    Free();
+    m_n_channels = n_channels;
+    m_n = n;
+    // in-place real-to-complex rows need room for NBins() complex values
+    m_dist = 2 * NBins();
+    m_mag.assign(n_channels * NBins(), 0);
+    if (!n_channels || !n) return;
+#ifdef FFTW_FOUND
+    m_buffer = fftwf_alloc_real(n_channels * m_dist);
+    std::unique_lock<std::mutex> lock(PlanMutex());
+    fftwf_plan & plan = Plans()[std::make_pair(n_channels, n)];
+    if (!plan) {
+      // planning overwrites the arrays, so plan on scratch memory with the same alignment
+      float * scratch = fftwf_alloc_real(n_channels * m_dist);
+      int size = int(n);
+      plan = fftwf_plan_many_dft_r2c(1, &size, int(n_channels), scratch, 0, 1, int(m_dist),
+                                     reinterpret_cast<fftwf_complex *>(scratch), 0, 1, int(NBins()), FFTW_MEASURE);
+      fftwf_free(scratch);
+      if (!WisdomFile().empty() && !fftwf_export_wisdom_to_filename(WisdomFile().c_str()))
+        EUDAQ_WARN("Could not write the FFTW wisdom to " + WisdomFile());
+    }
+    m_plan = plan;
+#else
+    m_buffer = new float[n_channels * m_dist];
+    std::unique_lock<std::mutex> lock(PlanMutex());
+    int size = int(n);
+    delete m_root_fft;
+    m_root_fft = TVirtualFFT::FFT(1, &size, "R2C");
+    m_in.resize(n);
+    m_re.resize(NBins());
+    m_im.resize(NBins());
+#endif
+  }
+
+  void WaveformFFT::SetInput(size_t i, const float * data, size_t n) {
+    float * row = m_buffer + i * m_dist;
+    n = std::min(n, m_n);
+    std::memcpy(row, data, n * sizeof(float));
+    std::fill(row + n, row + m_dist, 0.f);
+  }
+
+  void WaveformFFT::Transform() {
+    if (!m_buffer) return;
+#ifdef FFTW_FOUND
+    fftwf_execute_dft_r2c(m_plan, m_buffer, reinterpret_cast<fftwf_complex *>(m_buffer));
+#else
+    for (size_t i = 0; i < m_n_channels; i++) {
+      float * row = m_buffer + i * m_dist;
+      std::copy(row, row + m_n, m_in.begin());
+      m_root_fft->SetPoints(&m_in[0]);
+      m_root_fft->Transform();
+      m_root_fft->GetPointsComplex(&m_re[0], &m_im[0]);
+      for (size_t k = 0; k < NBins(); k++) {
+        row[2 * k] = float(m_re[k]);
+        row[2 * k + 1] = float(m_im[k]);
+      }
+    }
+#endif
+    for (size_t i = 0; i < m_n_channels; i++)
+      waveform::Magnitudes(m_buffer + i * m_dist, NBins(), &m_mag[i * NBins()]);
+  }
+
+}
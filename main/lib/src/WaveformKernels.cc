@@ -0,0 +1,182 @@
+#include "eudaq/WaveformKernels.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#if defined(__SSE2__)
+#  include <immintrin.h>
+#endif
+
+namespace eudaq {
+
+  namespace waveform {
+
+#if defined(__SSE2__)
+    namespace {
+      inline float HMin(__m128 v) {
+        v = _mm_min_ps(v, _mm_movehl_ps(v, v));
+        v = _mm_min_ss(v, _mm_shuffle_ps(v, v, 1));
+        return _mm_cvtss_f32(v);
+      }
+      inline float HMax(__m128 v) {
+        v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+        v = _mm_max_ss(v, _mm_shuffle_ps(v, v, 1));
+        return _mm_cvtss_f32(v);
+      }
+    }
+#endif
+
+    float Min(const float * data, size_t n) {
+      size_t i = 0;
+      float m = data[0];
+#if defined(__SSE2__)
+      if (n >= 8) {
+        __m128 v0 = _mm_loadu_ps(data), v1 = _mm_loadu_ps(data + 4);
+        for (i = 8; i + 8 <= n; i += 8) {
+          v0 = _mm_min_ps(v0, _mm_loadu_ps(data + i));
+          v1 = _mm_min_ps(v1, _mm_loadu_ps(data + i + 4));
+        }
+        m = HMin(_mm_min_ps(v0, v1));
+      }
+#endif
+      for (; i < n; i++)
+        if (data[i] < m) m = data[i];
+      return m;
+    }
+
+    float Max(const float * data, size_t n) {
+      size_t i = 0;
+      float m = data[0];
+#if defined(__SSE2__)
+      if (n >= 8) {
+        __m128 v0 = _mm_loadu_ps(data), v1 = _mm_loadu_ps(data + 4);
+        for (i = 8; i + 8 <= n; i += 8) {
+          v0 = _mm_max_ps(v0, _mm_loadu_ps(data + i));
+          v1 = _mm_max_ps(v1, _mm_loadu_ps(data + i + 4));
+        }
+        m = HMax(_mm_max_ps(v0, v1));
+      }
+#endif
+      for (; i < n; i++)
+        if (data[i] > m) m = data[i];
+      return m;
+    }
+
+    size_t ArgMin(const float * data, size_t n) {
+      if (n == 0) return 0;
+      float m = Min(data, n);
+      size_t i = 0;
+      while (i + 1 < n && !(data[i] == m)) i++;
+      return i;
+    }
+
+    size_t ArgMax(const float * data, size_t n) {
+      if (n == 0) return 0;
+      float m = Max(data, n);
+      size_t i = 0;
+      while (i + 1 < n && !(data[i] == m)) i++;
+      return i;
+    }
+
+    float Sum(const float * data, size_t n, bool abs) {
+      size_t i = 0;
+      float s[4] = {0, 0, 0, 0};
+#if defined(__SSE2__)
+      __m128 v = _mm_setzero_ps();
+      const __m128 mask = _mm_castsi128_ps(_mm_set1_epi32(abs ? 0x7fffffff : -1));
+      for (; i + 4 <= n; i += 4)
+        v = _mm_add_ps(v, _mm_and_ps(_mm_loadu_ps(data + i), mask));
+      _mm_storeu_ps(s, v);
+#endif
+      for (; i < n; i++)
+        s[i & 3] += abs ? std::fabs(data[i]) : data[i];
+      return (s[0] + s[1]) + (s[2] + s[3]);
+    }
+
+    float Median(const float * data, size_t n, std::vector<float> & scratch) {
+      if (n == 0) return 0;
+      scratch.assign(data, data + n);
+      std::vector<float>::iterator mid = scratch.begin() + n / 2;
+      std::nth_element(scratch.begin(), mid, scratch.end());
+      if (n % 2) return *mid;
+      // the other central value is the largest one below mid
+      return 0.5f * (*std::max_element(scratch.begin(), mid) + *mid);
+    }
+
+    void Magnitudes(const float * c, size_t n, float * out) {
+      size_t k = 0;
+#if defined(__SSE2__)
+      for (; k + 4 <= n; k += 4) {
+        __m128 a = _mm_loadu_ps(c + 2 * k), b = _mm_loadu_ps(c + 2 * k + 4);
+        __m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(out + k, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im))));
+      }
+#endif
+      for (; k < n; k++)
+        out[k] = std::sqrt(c[2 * k] * c[2 * k] + c[2 * k + 1] * c[2 * k + 1]);
+    }
+
+    void PrefixSums::Build(const float * data, size_t n, const float * times) {
+      m_data = data;
+      m_times = times;
+      m_n = n;
+      m_sum.resize(n + 1);
+      m_sum[0] = 0;
+      for (size_t i = 0; i < n; i++) m_sum[i + 1] = m_sum[i] + data[i];
+      if (!times || n < 2) return;
+      // the terms are independent and vectorise, only the accumulation is serial
+      m_terms.resize(n);
+      m_terms[0] = 0;
+      for (size_t i = 1; i + 1 < n; i++)
+        m_terms[i] = (times[i] - times[i - 1]) * ((data[i] + data[i + 1]) / 2);
+      m_trap.resize(n);
+      m_trap[0] = 0;
+      for (size_t i = 0; i + 1 < n; i++)
+        m_trap[i + 1] = m_trap[i] + m_terms[i];
+    }
+
+    float PrefixSums::Integral(uint16_t min, uint16_t max) const {
+      if (max > m_n - 1) max = uint16_t(m_n - 1);
+      float integral = min <= max ? float(Sum(min, max + 1u)) : 0;
+      return integral / (float) (max - (int) min);
+    }
+
+    float PrefixSums::Voltage(size_t ibin, float time) const {
+      /** straight line through the samples ibin - 1 and ibin, as StandardWaveform::interpolateVoltage */
+      float m = (m_data[ibin] - m_data[ibin - 1]) / (m_times[ibin] - m_times[ibin - 1]);
+      float a = m_data[ibin] - m * m_times[ibin];
+      return m * time + a;
+    }
+
+    float PrefixSums::TimeIntegral(uint16_t low_bin, uint16_t high_bin, uint16_t peak_pos, float sspeed) const {
+      high_bin = std::min(high_bin, uint16_t(m_n - 1));
+      if (high_bin == peak_pos and low_bin == peak_pos)
+        return m_data[peak_pos];
+      float max_low_length = (peak_pos - low_bin) / sspeed;
+      float max_high_length = (high_bin - peak_pos) / sspeed;
+      const float * t = m_times;
+      double integral = 0;
+      if (peak_pos == 0) return std::numeric_limits<float>::quiet_NaN();
+      // walk over full bins away from the peak until the length is reached, then add the rest of the length times the
+      // voltage at its end. As in StandardWaveform, bin i counts with the width of bin i - 1.
+      if (max_low_length >= 0.001) {
+        size_t m = std::upper_bound(t, t + peak_pos - 1, t[peak_pos - 1] - max_low_length) - t + 1;
+        integral += m_trap[peak_pos] - m_trap[m];
+        float rest = max_low_length - (t[peak_pos - 1] - t[m - 1]);
+        if (m > 1 and rest >= 0.001)
+          integral += rest * Voltage(m, t[m] - rest);
+      }
+      if (max_high_length >= 0.001) {
+        size_t m = std::lower_bound(t + peak_pos, t + m_n - 1, t[peak_pos - 1] + max_high_length) - t;
+        integral += m_trap[m] - m_trap[peak_pos];
+        float rest = max_high_length - (t[m - 1] - t[peak_pos - 1]);
+        if (m + 1 < m_n and rest >= 0.001)
+          integral += rest * Voltage(m + 1, t[m] + rest);
+      }
+      return float(integral) / (max_high_length + max_low_length);
+    }
+
+  }
+
+}
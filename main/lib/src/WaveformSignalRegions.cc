@@ -29,7 +29,7 @@ void WaveformSignalRegions::Print(std::ostream& out) const {
 }
 
 void WaveformSignalRegions::Reset(){
-    for (auto i: this->regions)
+    for (auto & i: this->regions)
             i.ResetIntegrals();
 }
 
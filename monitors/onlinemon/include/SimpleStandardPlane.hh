@@ -49,17 +49,17 @@ class SimpleStandardPlane {
     void addHit(SimpleStandardHit oneHit);
     void addRawHit(SimpleStandardHit oneHit);
     void doClustering();
-    std::vector<SimpleStandardHit> getHits() const { return _hits; }
-    std::vector<SimpleStandardHit> getRawHits() const { return _rawhits; }
-    std::vector<SimpleStandardCluster> getClusters() const { return _clusters; }
+    const std::vector<SimpleStandardHit> & getHits() const { return _hits; }
+    const std::vector<SimpleStandardHit> & getRawHits() const { return _rawhits; }
+    const std::vector<SimpleStandardCluster> & getClusters() const { return _clusters; }
     int getNHits() const { return _hits.size(); }
     int getNBadHits() const { return _badhits.size(); }
     int getNSectionHits(unsigned int section) const { return _section_hits[section].size(); }
     int getNClusters() const { return _clusters.size(); }
     int getNSectionClusters(unsigned int section) const { return _section_clusters[section].size(); }
-    SimpleStandardCluster getCluster(const int i ) const { return _clusters.at(i); }
-    SimpleStandardHit getHit(const int i) const { return _hits.at(i); }
-    SimpleStandardHit getRawHit(const int i) const { return _rawhits.at(i); }
+    const SimpleStandardCluster & getCluster(const int i ) const { return _clusters.at(i); }
+    const SimpleStandardHit & getHit(const int i) const { return _hits.at(i); }
+    const SimpleStandardHit & getRawHit(const int i) const { return _rawhits.at(i); }
     std::string getName() const {return _name; }
     std::string getBaseName() const {return _baseName; }
     void setTriggerPhase(unsigned char trig_phase){_trigger_phase=trig_phase;}
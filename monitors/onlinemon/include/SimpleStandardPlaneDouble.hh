@@ -20,8 +20,8 @@ class SimpleStandardPlaneDouble {
       sprintf(out, "%s%i_vs_%s%i",_p1.getName().c_str(),_p1.getID(),_p2.getName().c_str(),_p2.getID());
       return std::string(out);
     }
-    SimpleStandardPlane getPlane1() const { return _p1; }
-    SimpleStandardPlane getPlane2() const { return _p2; }
+    const SimpleStandardPlane & getPlane1() const { return _p1; }
+    const SimpleStandardPlane & getPlane2() const { return _p2; }
 };
 
 #endif //ifndef SIMPLESTANDARDPLANEDOUBLE_HH_
@@ -24,6 +24,7 @@
 #include "SimpleStandardEvent.hh"
 #include "TGraphSet.hh"
 #include "WaveformOptions.hh"
+#include "eudaq/WaveformKernels.hh"
 
 
 class RootMonitor;
@@ -109,6 +110,8 @@ class WaveformHistos {
     std::pair<float,float> pedestal_integral_range;
     std::pair<float,float> signal_integral_range;
     std::pair<float,float> pulser_integral_range;
+    eudaq::waveform::PrefixSums sums;  ///< of the waveform being filled
+    float getIntegral(const SimpleStandardWaveform & wf, float min, float max) const;
     unsigned int n_fills;
     unsigned int n_fills_good;
     unsigned int n_fills_bad;
@@ -70,8 +70,8 @@ void CorrelationCollection::fillHistograms(const SimpleStandardPlaneDouble &simp
   CorrelationHistos *corrmap = _mapOld[simpPlaneDouble];
 
   if (corrmap != NULL) {
-    const vector< SimpleStandardCluster > aClusters = simpPlaneDouble.getPlane1().getClusters();
-    const vector< SimpleStandardCluster > bClusters = simpPlaneDouble.getPlane2().getClusters();
+    const vector< SimpleStandardCluster > & aClusters = simpPlaneDouble.getPlane1().getClusters();
+    const vector< SimpleStandardCluster > & bClusters = simpPlaneDouble.getPlane2().getClusters();
 
     for (unsigned int acluster = 0; acluster < aClusters.size(); acluster++)
     {
@@ -255,7 +255,7 @@ unsigned int CorrelationCollection::FillWithTracks(const SimpleStandardEvent &si
       const SimpleStandardPlane& simpPlane = simpev.getPlane(planeA);
       if (skip_this_plane[planeA] == false) //adding plane for analysis if selected
       {
-        vector<SimpleStandardCluster> clustersBeforeDeletion = simpPlane.getClusters();
+        const vector<SimpleStandardCluster> & clustersBeforeDeletion = simpPlane.getClusters();
         vector<SimpleStandardCluster> clustersAfterDeletion;
         clustersAfterDeletion.reserve(20);
         remove_copy_if(clustersBeforeDeletion.begin(), clustersBeforeDeletion.end(),
@@ -399,8 +399,8 @@ void CorrelationCollection::fillHistograms(const SimpleStandardPlane& p1, const
   }
   else
   {
-    const std::vector<SimpleStandardCluster> aClusters=p1.getClusters();
-    const std::vector<SimpleStandardCluster> bClusters=p2.getClusters();
+    const std::vector<SimpleStandardCluster> & aClusters=p1.getClusters();
+    const std::vector<SimpleStandardCluster> & bClusters=p2.getClusters();
 
 
     for (unsigned int acluster = 0; acluster < aClusters.size();acluster++)
@@ -7,6 +7,7 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include "include/SimpleStandardPlane.hh"
 
 SimpleStandardPlane::SimpleStandardPlane(const std::string & name, const int id, const int maxX, const int maxY, const int tlu_event, const int pivot_pixel, OnlineMonConfiguration* mymon) :
@@ -99,135 +100,110 @@ void SimpleStandardPlane::reducePixels(const int reduceX, const int reduceY) {
   //std::cout << "Reducing " << reduce << " -> " << _reduce <<" " << _maxX << " -> " << _binsX << " " << _maxY << " -> " << _binsY << std::endl;
 }
 
-void SimpleStandardPlane::doClustering() {
-  int nClusters = 0;
-  std::vector<int> clusterNumber;
-  const int NOCLUSTER = -1000;
-  const unsigned int minXDistance = 1;
-  const unsigned int minYDistance = 1;
-  const unsigned int npixels_hit=_hits.size();
-  bool continue_flag;
-  clusterNumber.assign(npixels_hit, NOCLUSTER);
-  //std::cout << "Before big loop" << std::endl;
-  //std::cout << "Name: " << _name << std::endl;
+namespace {
+  /** scratch space of doClustering, kept between events since the planes are rebuilt for every event */
+  struct ClusterWorkspace {
+    std::vector<int> grid;                     // hit index + 1 for every pixel of the plane, 0 = no hit
+    std::unordered_map<long long, int> outside; // the same for hits outside of [0, maxX] x [0, maxY]
+    std::vector<int> parent;                   // union-find forest over the hits
+    std::vector<int> label;                    // cluster index of each root
+  };
+  thread_local ClusterWorkspace t_workspace;
+
+  long long outsideKey(int x, int y) { return (long long)(((unsigned long long)(unsigned int)x << 32) | (unsigned int)y); }
 
+  int findRoot(std::vector<int> & parent, int i) {
+    while (parent[i] != i) {
+      parent[i] = parent[parent[i]];
+      i = parent[i];
+    }
+    return i;
+  }
+}
+
+void SimpleStandardPlane::doClustering() {
   // which planes to cluster, reject planes of Type Fortis
   if (is_FORTIS)
   {
     return;
   }
 
-  if (npixels_hit > 1)// (npixels_hit < 2000 ))
+  /** connected components of the hits touching each other (also diagonally): every hit is joined with the hits already
+   *  stored in its 3x3 neighbourhood of the occupancy grid, so this is linear in the number of hits */
+  ClusterWorkspace & ws = t_workspace;
+  const int npixels_hit = _hits.size();
+  const int ny = _maxY + 1;
+  const bool dense = _maxX >= 0 && _maxY >= 0;
+  if (dense && ws.grid.size() < size_t(_maxX + 1) * ny)
+    ws.grid.resize(size_t(_maxX + 1) * ny, 0);
+  ws.parent.resize(npixels_hit);
+  for (int i = 0; i < npixels_hit; i++)
+    ws.parent[i] = i;
+
+  for (int i = 0; i < npixels_hit; i++)
   {
-    std::sort(_hits.begin(), _hits.end(), SortHitsByXY());
-    for (unsigned int aPixel = 0; aPixel < npixels_hit; aPixel++)
+    const int x = _hits[i].getX();
+    const int y = _hits[i].getY();
+    for (int ix = x - 1; ix <= x + 1; ix++)
     {
-      continue_flag = true;
-      const SimpleStandardHit& aPix = _hits.at(aPixel);
-      for (unsigned int bPixel = aPixel+1; bPixel < npixels_hit; bPixel++)
+      for (int iy = y - 1; iy <= y + 1; iy++)
       {
-        if (continue_flag != true)
-          break;
-        //for (std::vector<SimpleStandardHit>::const_iterator hit = _hits.begin();
-        //   hit != _hits.end();
-        //std::cout << aPixel << " " << bPixel << " " << _hits.size() << std::endl;
-        const SimpleStandardHit& bPix = _hits.at(bPixel);
-        unsigned int xDist = abs(aPix.getX() - bPix.getX());
-        unsigned int yDist = abs(aPix.getY() - bPix.getY());
-
-        if ( ( xDist <= minXDistance) && (yDist <= minYDistance)  )
-        { //this means they are neighbors in x-direction && / this means they are neighbors in y-direction
-          if ( (clusterNumber.at(aPixel) == NOCLUSTER) && clusterNumber.at(bPixel) == NOCLUSTER)
-          { // none of these pixels have been assigned to a cluster
-            //++nClusters;
-            clusterNumber.at(aPixel) = ++nClusters;
-            clusterNumber.at(bPixel) = nClusters;
-          }
-          else if ( (clusterNumber.at(aPixel) == NOCLUSTER) && (clusterNumber.at(bPixel) != NOCLUSTER))
-          { // b was assigned already, a not
-            clusterNumber.at(aPixel) = clusterNumber.at(bPixel);
-          }
-          else if ( (clusterNumber.at(aPixel) != NOCLUSTER) && (clusterNumber.at(bPixel) == NOCLUSTER))
-          { // a was assigned already, b not
-            clusterNumber.at(bPixel) = clusterNumber.at(aPixel);
-          }
-          else
-          { //both pixels have a cluster number already
-            int min = std::min(clusterNumber.at(aPixel), clusterNumber.at(bPixel));
-            clusterNumber.at(aPixel) = min;
-            clusterNumber.at(bPixel) = min;
-          }
-        }
+        int j;
+        if (dense && ix >= 0 && ix <= _maxX && iy >= 0 && iy <= _maxY)
+          j = ws.grid[size_t(ix) * ny + iy] - 1;
         else
-        {   // these pixels are not neighbored
-          continue_flag = false;
+        {
+          std::unordered_map<long long, int>::const_iterator it = ws.outside.find(outsideKey(ix, iy));
+          j = it == ws.outside.end() ? -1 : it->second - 1;
         }
-        /*
-           if ( clusterNumber.at(aPixel) == NOCLUSTER )
-           {
-           ++nClusters;
-           clusterNumber.at(aPixel) = nClusters;
-           }
-           if ( clusterNumber.at(bPixel) == NOCLUSTER )
-           {
-           ++nClusters;
-           clusterNumber.at(bPixel) = nClusters;
-           }
-           }*/
-    } // inner for loop
-  } //outer for loop
-  for(unsigned int aPixel = 0; aPixel < npixels_hit; aPixel++)
-    if ( clusterNumber.at(aPixel) == NOCLUSTER )
-    {
-      ++nClusters;
-      clusterNumber.at(aPixel) = nClusters;
+        if (j < 0) continue;
+        // the root is always the first hit of a cluster, so the clusters come out in the order of the hits
+        int ri = findRoot(ws.parent, i), rj = findRoot(ws.parent, j);
+        if (ri != rj) ws.parent[std::max(ri, rj)] = std::min(ri, rj);
+      }
     }
-}
-else
-{ //You can't use the clustering algorithm with only one pixel
-  if (npixels_hit == 1) clusterNumber.at(0) = 1;
-}
-
-//std::cout << "After big loop" << std::endl;
-std::set<int> clusterSet (clusterNumber.begin(), clusterNumber.end());
+    if (dense && x >= 0 && x <= _maxX && y >= 0 && y <= _maxY)
+      ws.grid[size_t(x) * ny + y] = i + 1;
+    else
+      ws.outside[outsideKey(x, y)] = i + 1;
+  }
 
-/*for (unsigned int i=0; i<npixels_hit;++i) {
-  if ( clusterNumber.at(i) != NOCLUSTER) {
-//std::cerr << "Cluster with ID -1 in " << i << std::endl;
-//} else {
-clusterSet.insert(clusterNumber.at(i));
-}
-}*/
-nClusters = clusterSet.size();
+  // reset only the cells we touched
+  for (int i = 0; i < npixels_hit; i++)
+  {
+    const int x = _hits[i].getX();
+    const int y = _hits[i].getY();
+    if (dense && x >= 0 && x <= _maxX && y >= 0 && y <= _maxY)
+      ws.grid[size_t(x) * ny + y] = 0;
+  }
+  ws.outside.clear();
 
-std::set<int>::iterator it;
-for (it=clusterSet.begin();it!=clusterSet.end();++it)
-{
-  SimpleStandardCluster cluster;
-  for (unsigned int i=0;i< npixels_hit;i++)
+  _clusters.clear();
+  ws.label.assign(npixels_hit, -1);
+  for (int i = 0; i < npixels_hit; i++)
   {
-    if (clusterNumber.at(i) == *it)
-    { //Put only these pixels in that ClusterCollection that belong to that cluster
-      cluster.addPixel(_hits.at(i));
+    const int root = findRoot(ws.parent, i);
+    if (ws.label[root] < 0)
+    {
+      ws.label[root] = _clusters.size();
+      _clusters.push_back(SimpleStandardCluster());
     }
+    _clusters[ws.label[root]].addPixel(_hits[i]);
   }
-  _clusters.push_back(cluster);
-  //std::cout << "Cluster at: " << cluster.getX() << std::endl;
-}
-// if we have a mimosa, we need to fill the section information
 
-if (is_MIMOSA26)
-{
-  for (unsigned int mycluster=0; mycluster<_clusters.size(); mycluster++)
+  // if we have a mimosa, we need to fill the section information
+  if (is_MIMOSA26)
   {
-    unsigned int cluster_section=_clusters[mycluster].getX()/mon->getMimosa26_section_boundary();
-    if (cluster_section<mon->getMimosa26_max_sections()) //fixme
+    for (unsigned int mycluster=0; mycluster<_clusters.size(); mycluster++)
     {
-      _section_clusters[cluster_section].push_back(_clusters[mycluster]);
+      unsigned int cluster_section=_clusters[mycluster].getX()/mon->getMimosa26_section_boundary();
+      if (cluster_section<mon->getMimosa26_max_sections()) //fixme
+      {
+        _section_clusters[cluster_section].push_back(_clusters[mycluster]);
+      }
     }
   }
 }
-}
 
 void SimpleStandardPlane::setPixelType(std::string name)
 {
@@ -432,6 +432,15 @@ void WaveformHistos::Fill(const SimpleStandardWaveform & wf)
     // else
     //     this->FillSignalEvent(wf);
 }
+/** same as SimpleStandardWaveform::getIntegral(min, max), from the running sums */
+float WaveformHistos::getIntegral(const SimpleStandardWaveform & wf, float min, float max) const {
+    int first = min;
+    int last = std::min(int(max + 1), int(wf.getNSamples()) - 1);
+    if (first < 0 || first > last)
+        return wf.getIntegral(min, max);
+    return float(sums.Sum(first, last + 1)) / float(last + 1 - first);
+}
+
 void WaveformHistos::FillEvent(const SimpleStandardWaveform & wf, bool isPulserEvent){
     int event_no = wf.getEvent();
     ULong64_t timestamp = wf.getTimestamp();
@@ -463,9 +472,10 @@ void WaveformHistos::FillEvent(const SimpleStandardWaveform & wf, bool isPulserE
     float signal_maximum    = wf.getMaximum (signal_integral_range.first  ,signal_integral_range.second);
     float signal_minimum    = wf.getMinimum (signal_integral_range.first  ,signal_integral_range.second);
 
-    float signal_integral   = wf.getIntegral(signal_integral_range.first  ,signal_integral_range.second);
-    float pedestal_integral = wf.getIntegral(pedestal_integral_range.first,pedestal_integral_range.second);
-    float pulser_integral   = wf.getIntegral(pulser_integral_range.first,pulser_integral_range.second);
+    sums.Build(wf.getData(), wf.getNSamples());
+    float signal_integral   = getIntegral(wf, signal_integral_range.first  ,signal_integral_range.second);
+    float pedestal_integral = getIntegral(wf, pedestal_integral_range.first,pedestal_integral_range.second);
+    float pulser_integral   = getIntegral(wf, pulser_integral_range.first,pulser_integral_range.second);
     ULong64_t time_stamp = wf.getTimestamp();
 
     std::map<std::string, TH1*>::iterator it ;
@@ -13,6 +13,8 @@
 #include "eudaq/Producer.hh"
 #include "eudaq/Timer.hh"
 #include "eudaq/Configuration.hh"
+#include "eudaq/RawDataEvent.hh"
+#include "eudaq/SPSCRing.hh"
 
 #include <math.h>
 #include <signal.h>
@@ -21,6 +23,19 @@
 #include <vector>
 #include <time.h>
 #include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+/** One read out trigger, handed from the readout loop to the sender thread */
+struct DRS4Readout {
+	int trigger_cell;
+	std::uint64_t timestamp;
+	unsigned event;
+	float waves[4][1024];
+};
 
 
 class DRS4Producer: public eudaq::Producer  {
@@ -30,10 +45,15 @@ public:
 	virtual void OnStartRun(unsigned runnumber);
 	virtual void OnStopRun();
 	virtual void OnTerminate();
+	virtual void OnStatus();
 	void ReadoutLoop();
+	void SenderLoop();
 	//  virtual ~DRS4Producer();
 private:
-	virtual void SendRawEvent();
+	/** Called with m_mutex held, returns without reading out if the run ends while it waits for a free slot */
+	void ReadoutEvent(std::unique_lock<std::mutex> & lock);
+	void PackEvent(const DRS4Readout & data, eudaq::RawDataEvent & ev);
+	void StopSender();
 	void SetTimeStamp();
 	unsigned m_run, m_ev;
 	unsigned m_tlu_waiting_time;
@@ -49,7 +69,19 @@ private:
 	bool is_initalized;
 	float time_array[8][1024];
 	unsigned short raw_wave_array[8][1024];
-	float wave_array[8][1024];
+	char m_channel_headers[8][6];
+	std::vector<unsigned short> m_packed;
+
+	/** readout -> sender pipeline: the board is re-armed right after the transfer,
+	 *  packing and sending the event happens in m_sender */
+	eudaq::SPSCRing<DRS4Readout> m_ring;
+	std::unique_ptr<std::thread> m_sender;
+	std::atomic<bool> m_stop_sender;
+	std::mutex m_mutex; ///< held by the readout loop while it uses the board
+	std::condition_variable m_cv_run;
+	std::atomic<uint64_t> m_n_read, m_dead_ns, m_n_stalls;
+	std::atomic<size_t> m_ring_peak;
+	uint64_t m_last_read, m_last_dead_ns;
 	int n_channels;
 	bool m_chnOn[8]; //todo fill with active channels
 	std::map<int,std::string> names;
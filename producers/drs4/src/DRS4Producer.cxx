@@ -32,8 +32,14 @@ DRS4Producer::DRS4Producer(const std::string & name, const std::string & runcont
 		m_inputRange(0.),
 		m_running(false), 
         m_terminated(false),
-        is_initalized(false){
+        is_initalized(false),
+        m_packed(1024),
+        m_stop_sender(false),
+        m_n_read(0), m_dead_ns(0), m_n_stalls(0), m_ring_peak(0),
+        m_last_read(0), m_last_dead_ns(0){
 	n_channels = 4;
+	for (int ch = 0; ch < 8; ch++)
+		sprintf(m_channel_headers[ch], "C%03d\n", ch+1);
 	cout<<"Started DRS4Producer with Name: \""<<name<<"\""<<endl;
 
 	m_b = 0;
@@ -115,11 +121,23 @@ void DRS4Producer::OnStartRun(unsigned runnumber) {
 
 		std::cout << "BORE for DRS4 Board: (event type"<<m_event_type<<")\tself trigger: "<<m_self_triggering<<endl;
 
+		/* Start the sender thread, then the readout */
+		StopSender();
+		m_ring.reset(m_config.Get("ring_size", 128));
+		m_n_read = m_dead_ns = m_n_stalls = 0;
+		m_ring_peak = 0;
+		m_last_read = m_last_dead_ns = 0;
+		m_stop_sender = false;
+		m_sender = std::unique_ptr<std::thread>(new std::thread(&DRS4Producer::SenderLoop, this));
+
 		SetStatus(eudaq::Status::LVL_OK, "Running");
-		m_running = true;
-		/* Start Readout */
-		if (m_b)
-			m_b->StartDomino();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_running = true;
+			if (m_b)
+				m_b->StartDomino();
+		}
+		m_cv_run.notify_all();
 	}
 	catch (...){
 		EUDAQ_ERROR(string("Unknown exception."));
@@ -134,6 +152,7 @@ void DRS4Producer::OnStopRun() {
     // Wait before we stop the DAQ because TLU takes some time to pick up the OnRunStop signal
     // otherwise the last triggers get lost.
     eudaq::mSleep(m_tlu_waiting_time);
+	std::unique_lock<std::mutex> lock(m_mutex); // waits until the readout loop is done with the current trigger
 	m_running = false;
 	std::cout << "Run stopped." << std::endl;
 	try {
@@ -141,10 +160,12 @@ void DRS4Producer::OnStopRun() {
 		if (m_b && m_b->IsBusy()) {
 			m_b->SoftTrigger();
 			for (int i=0 ; i<10 && m_b->IsBusy() ; i++)
-				usleep(10);//todo not mt save
+				usleep(10);
 		}
+		lock.unlock();
 
-	    // Sending the final end-of-run event:
+	    // All read out events go out before the final end-of-run event:
+		StopSender();
 	    SendEvent(eudaq::RawDataEvent::EORE(m_event_type, m_run, m_ev));
 	    std::cout << "Stopped" << std::endl;
 
@@ -163,13 +184,19 @@ void DRS4Producer::OnStopRun() {
 };
 
 void DRS4Producer::OnTerminate() {
-	m_terminated = true;
+	{
+	  std::lock_guard<std::mutex> lock(m_mutex);
+	  m_terminated = true;
 
 	  // If we already have a pxarCore instance, shut it down cleanly:
 	  if(m_drs != NULL) {
 	    delete m_drs;
 	    m_drs = NULL;
+	    m_b = 0;
 	  }
+	}
+	m_cv_run.notify_all();
+	StopSender();
 
 	  std::cout << "DRS4Producer " << m_producerName << " terminated." << std::endl;
 };
@@ -177,48 +204,85 @@ void DRS4Producer::OnTerminate() {
 void DRS4Producer::ReadoutLoop() {
     std::cout<<"Start ReadoutLoop "<<m_terminated<<std::endl;
 	int k = 0;
+	std::unique_lock<std::mutex> lock(m_mutex);
 	while (!m_terminated) {
-		// No run is m_running, cycle and wait:
-		if(!m_running) {
-			// Move this thread to the end of the scheduler queue:
-			sched_yield();
+		// No run is m_running, sleep until OnStartRun or OnTerminate:
+		if (!m_running || !m_b) {
+			m_cv_run.wait_for(lock, std::chrono::milliseconds(100));
 			continue;
 		}
-		else {
-			if (!m_b)
-				continue;
-			k++;
-			//Check if ready for triggers
-			if ( m_b->IsBusy()){
-				if (m_self_triggering && k%(int)1e4 == 0 ){
-					cout<<"Send software trigger"<<endl;
-					m_b->SoftTrigger();
-					usleep(10); //todo not mt save
-				}
-				else{
-					//					cout<<"continue"<<m_self_triggering<<"/"<<k<<endl;
-					continue;
-				}
-			}
-			// Trying to get the next event, daqGetRawEvent throws exception if none is available:
-			try {
-				SendRawEvent();
-                std::cout << "DRS4 Event number: " << m_ev << std::endl;
-				if(m_ev%1000 == 0) {
-					std::cout << "DRS4 Board "
-							<< " EVT " << m_ev << std::endl;
-				}
+		k++;
+		//Check if ready for triggers
+		if ( m_b->IsBusy()){
+			if (m_self_triggering && k%(int)1e4 == 0 ){
+				cout<<"Send software trigger"<<endl;
+				m_b->SoftTrigger();
+				usleep(10);
 			}
-			catch(int e) {
-				// No event available in derandomize buffers (DTB RAM), return to scheduler:
-				cout << "An exception occurred. Exception Nr. " << e << '\n';
+			else{
+				// let OnStopRun and OnTerminate in between two polls
+				lock.unlock();
 				sched_yield();
+				lock.lock();
 			}
+			continue;
+		}
+		try {
+			ReadoutEvent(lock);
+			if(m_ev%1000 == 0) {
+				std::cout << "DRS4 Board "
+						<< " EVT " << m_ev << std::endl;
+			}
+		}
+		catch(int e) {
+			cout << "An exception occurred. Exception Nr. " << e << '\n';
 		}
 	}
     std::cout<<"ReadoutLoop Done. " << std::endl;
 };
 
+void DRS4Producer::SenderLoop() {
+	for (;;) {
+		DRS4Readout * data = m_ring.wait_front(100);
+		if (!data) {
+			if (m_stop_sender && m_ring.empty())
+				break;
+			continue;
+		}
+		try {
+			eudaq::RawDataEvent ev(m_event_type, m_run, data->event);
+			PackEvent(*data, ev);
+			// the slot is free again before the (possibly blocking) send
+			m_ring.pop();
+			SendEvent(ev);
+		} catch (const std::exception & e) {
+			EUDAQ_ERROR(string("Error sending event: ") + e.what());
+			SetStatus(eudaq::Status::LVL_ERROR, "Error sending event");
+		}
+	}
+}
+
+void DRS4Producer::StopSender() {
+	if (!m_sender)
+		return;
+	m_stop_sender = true;
+	m_ring.wake();
+	m_sender->join();
+	m_sender.reset();
+}
+
+void DRS4Producer::OnStatus() {
+	uint64_t n_read = m_n_read, dead_ns = m_dead_ns;
+	// mean dead time per trigger since the last status update
+	if (n_read > m_last_read)
+		m_status.SetTag("DEADTIME", std::to_string((dead_ns - m_last_dead_ns) / 1e3 / (n_read - m_last_read)));
+	m_last_read = n_read;
+	m_last_dead_ns = dead_ns;
+	m_status.SetTag("RINGFILL", std::to_string(m_ring.size()));
+	m_status.SetTag("RINGPEAK", std::to_string(m_ring_peak));
+	m_status.SetTag("RINGSTALLS", std::to_string(m_n_stalls));
+}
+
 void DRS4Producer::OnConfigure(const eudaq::Configuration& conf) {
 	cout << "Configure DRS4 board"<<endl;
 	m_config = conf;
@@ -379,60 +443,66 @@ int main(int /*argc*/, const char ** argv) {
 }
 
 
-void DRS4Producer::SendRawEvent() {
+void DRS4Producer::ReadoutEvent(std::unique_lock<std::mutex> & lock) {
 	/* Set Time stamp */
 	SetTimeStamp();
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	/* the trigger stays latched in the board while the sender frees a slot */
+	DRS4Readout * data = m_ring.back();
+	if (!data) {
+		++m_n_stalls;
+		// let OnStopRun and OnTerminate in while waiting, a stalled sender must not block them
+		while (!data) {
+			lock.unlock();
+			data = m_ring.wait_back(100);
+			lock.lock();
+			if (!m_running || m_terminated || !m_b)
+				return;
+		}
+	}
+	data->timestamp = m_timestamp;
 	/* read all waveforms */
 	m_b->TransferWaves(0, 8);//todo: ist das anpassbar?
+	data->trigger_cell = m_b->GetTriggerCell(0);
+
+	/* Restart Readout */
+	m_b->StartDomino();
+	m_dead_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
 
 	for (int ch = 0; ch < n_channels; ch++){
-		/* read time (X) array of  channel in ns
+		if (!m_chnOn[ch])
+			continue;
+		/* decode waveform (Y) array of channel in mV from the transferred data, the board already takes the next event.
 						   Note: On the evaluation board input #1 is connected to channel 0 and 1 of
 						   the DRS chip, input #2 is connected to channel 2 and 3 and so on. So to
 						   get the input #2 we have to read DRS channel #2, not #1. */
-		//					m_b->GetTime(0, ch*2, m_b->GetTriggerCell(0), time_array[ch*2]);
-		/* decode waveform (Y) array of first channel in mV */
-		m_b->GetWave(0, ch*2, wave_array[ch]);
-//		m_b->GetRawWave(0,ch*2,raw_wave_array[ch]);
-
+		m_b->GetWave(0, ch*2, data->waves[ch]);
 	}
-	int trigger_cell = m_b->GetTriggerCell(0);
-
-
-	/* Restart Readout */
-	m_b->StartDomino();
-	/* print some progress indication */
-//	printf("\rEvent #%6d read successfully\n",m_ev);
+	data->event = m_ev++;
+	m_ring.push();
+	++m_n_read;
+	if (m_ring.size() > m_ring_peak)
+		m_ring_peak = m_ring.size();
+}
 
-	eudaq::RawDataEvent ev(m_event_type, m_run, m_ev);
+void DRS4Producer::PackEvent(const DRS4Readout & data, eudaq::RawDataEvent & ev) {
 	unsigned int block_no = 0;
-	ev.AddBlock(block_no, reinterpret_cast<const char*>(&trigger_cell), sizeof( trigger_cell));				//				ev.AddBlock(block_no,"EHDR");
-	block_no++;
-	ev.AddBlock(block_no, reinterpret_cast<const char*>(&m_timestamp), sizeof( m_timestamp));				//				ev.AddBlock(block_no,"EHDR");
-	block_no++;
+	ev.AddBlock(block_no++, reinterpret_cast<const char*>(&data.trigger_cell), sizeof(data.trigger_cell));
+	ev.AddBlock(block_no++, reinterpret_cast<const char*>(&data.timestamp), sizeof(data.timestamp));
+	const int n_samples = 1024;
+	unsigned short * raw_wave = &m_packed[0];
 	for (int ch = 0; ch < n_channels; ch++){
 		if (!m_chnOn[ch])
 			continue;
-		char buffer [6];
-		sprintf(buffer, "C%03d\n", ch+1);
-		ev.AddBlock(block_no++, reinterpret_cast<const char*>(buffer),sizeof(buffer));
-		/* Set data block of ch, each channel ist connected to to DRS channels*/
-		int n_samples = 1024;
-		int n_drs_channels = 1;
-		unsigned short raw_wave_array[n_samples];
-		//Merge both drs channels to the output of the channel
-		for (int drs_ch = 0; drs_ch < n_drs_channels; drs_ch++){
-			for (int i =0; i<n_samples/n_drs_channels; i++)
-				raw_wave_array[i+1024*drs_ch] = (unsigned short)((wave_array[ch+drs_ch][i]/1000.0 - m_inputRange + 0.5) * 65535);
-		}
-		ev.AddBlock(block_no++, reinterpret_cast<const char*>(&raw_wave_array), sizeof( raw_wave_array[0])*n_samples);
+		ev.AddBlock(block_no++, m_channel_headers[ch], sizeof(m_channel_headers[ch]));
+		const float * wave = data.waves[ch];
+		for (int i = 0; i < n_samples; i++)
+			raw_wave[i] = (unsigned short)((wave[i]/1000.0 - m_inputRange + 0.5) * 65535);
+		ev.AddBlock(block_no++, reinterpret_cast<const char*>(raw_wave), sizeof(raw_wave[0])*n_samples);
 	}
-    if ( m_ev < 50 || m_ev % 100 == 0) {
-	    cout<< "\rSend Event" << std::setw(7) << m_ev << " " << std::setw(1) <<  m_self_triggering << "Trigger cell: " << std::setw(4) << trigger_cell << ", " << std::flush;
+    if (data.event < 50 || data.event % 100 == 0) {
+	    cout<< "\rSend Event" << std::setw(7) << data.event << " " << std::setw(1) <<  m_self_triggering << "Trigger cell: " << std::setw(4) << data.trigger_cell << ", " << std::flush;
     }
-	SendEvent(ev);
-	m_ev++;
-	//				if(daqEvent.data.size() > 1) { m_ev_filled++; m_ev_runningavg_filled++; }
 }
 
 void DRS4Producer::SetTimeStamp() {
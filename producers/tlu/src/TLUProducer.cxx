@@ -92,6 +92,7 @@ public:
 		SetStatus(eudaq::Status::LVL_OK, "Wait");
 		try {
 			std::cout << "Configuring (" << param.Name() << ")..." << std::endl;
+			SetBatching(param);
 			if (m_tlu)
 				m_tlu = 0;
 			int errorhandler = param.Get("ErrorHandler", 2);
@@ -302,6 +302,7 @@ void TUProducer::OnConfigure(const eudaq::Configuration& conf) {
 
 	try {
 		SetStatus(eudaq::Status::LVL_OK, "Wait");
+		SetBatching(conf);  // the small scaler events are worth batching at high rates
 
 		std::string ip_adr = conf.Get("ip_adr", "192.168.1.120");
 		tc->set_ip_adr(ip_adr);